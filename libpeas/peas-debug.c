@@ -24,6 +24,7 @@
 #endif
 
 #include "libpeas/peas-debug.h"
+#include "libpeas/peas-trace.h"
 
 
 static void
@@ -44,4 +45,6 @@ peas_debug_init (void)
                          debug_log_handler,
                          NULL);
     }
+
+  _peas_trace_init ();
 }
@@ -112,6 +112,19 @@ peas_dirs_get_plugin_loaders_dir (void)
   return loader_dir;
 }
 
+gchar *
+peas_dirs_get_plugin_cache_dir (void)
+{
+  const gchar *env_var;
+
+  /* An empty value disables the plugin cache */
+  env_var = g_getenv ("PEAS_PLUGIN_CACHE_DIR");
+  if (env_var != NULL)
+    return *env_var != '\0' ? g_strdup (env_var) : NULL;
+
+  return g_build_filename (g_get_user_cache_dir (), "libpeas-1.0", NULL);
+}
+
 gchar *
 peas_dirs_get_locale_dir (void)
 {
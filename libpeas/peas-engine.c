@@ -24,16 +24,19 @@
 #include <config.h>
 #endif
 
+#include <stdlib.h>
 #include <string.h>
 
 #include "peas-i18n.h"
 #include "peas-engine.h"
 #include "peas-plugin-info-priv.h"
+#include "peas-plugin-cache.h"
 #include "peas-plugin-loader.h"
 #include "peas-object-module.h"
 #include "peas-extension.h"
 #include "peas-dirs.h"
 #include "peas-debug.h"
+#include "peas-trace.h"
 #include "peas-helpers.h"
 
 /**
@@ -63,16 +66,30 @@ static PeasEngine *default_engine = NULL;
 enum {
   LOAD_PLUGIN,
   UNLOAD_PLUGIN,
+  LOADED_PLUGINS_CHANGED,
   LAST_SIGNAL
 };
 
 static guint signals[LAST_SIGNAL];
 
+/**
+ * peas_engine_error_quark:
+ *
+ * Returns: the #GQuark of the #PEAS_ENGINE_ERROR error domain.
+ */
+GQuark
+peas_engine_error_quark (void)
+{
+  return g_quark_from_static_string ("peas-engine-error");
+}
+
 /* Properties */
 enum {
   PROP_0,
   PROP_PLUGIN_LIST,
-  PROP_LOADED_PLUGINS
+  PROP_LOADED_PLUGINS,
+  PROP_PARALLEL_SCAN,
+  PROP_PREFETCH_PLUGINS
 };
 
 typedef struct _LoaderInfo LoaderInfo;
@@ -91,7 +108,73 @@ struct _PeasEnginePrivate {
   GList *search_paths;
 
   GList *plugin_list;
+  /* module name -> PeasPluginInfo */
+  GHashTable *plugin_names;
+  /* module name -> GList of the PeasPluginInfos depending on it */
+  GHashTable *dependents;
+  /* extension type name -> GList of the PeasPluginInfos declaring it */
+  GHashTable *extension_types;
+  /* The plugins sorted after their dependencies, computed on demand */
+  GPtrArray *topological_order;
   GHashTable *loaders;
+
+  /* The plugins whose state changed in the current transaction,
+   * mapped to whether they were loaded when it began */
+  guint transaction_depth;
+  GHashTable *changed_plugins;
+  GList *changed_plugins_order;
+
+  /* fingerprint -> SharedExtension, the extensions are weakly referenced */
+  GHashTable *shared_extensions;
+
+  guint parallel_scan : 1;
+  guint prefetch_plugins : 1;
+};
+
+/* An extension handed out by peas_engine_get_shared_extensionv() */
+typedef struct {
+  PeasEngine *engine;
+  PeasPluginInfo *info;
+  gchar *fingerprint;
+  PeasExtension *exten;
+
+  /* The objects passed as parameters, weakly referenced too */
+  GPtrArray *objects;
+} SharedExtension;
+
+/* Directories are scanned by a pool of threads when the parallel-scan
+ * property is set, and the plugin info files of each directory are loaded
+ * in batches. The results are then merged on the calling thread in the
+ * same order as a serial scan. */
+#define SCAN_MAX_THREADS   8
+#define SCAN_FILES_PER_JOB 16
+
+typedef struct _ParallelScan ParallelScan;
+typedef struct _ScanNode ScanNode;
+typedef struct _ScanJob ScanJob;
+
+struct _ParallelScan {
+  GThreadPool *pool;
+  GMutex *lock;
+  GCond *cond;
+  guint n_pending;
+};
+
+struct _ScanNode {
+  PeasPluginCache *cache;
+  gchar *module_dir;
+  const gchar *data_dir;
+  guint recursions;
+
+  PeasPluginCacheDir *dir;
+  GPtrArray *children;
+};
+
+struct _ScanJob {
+  ScanNode *node;
+  guint first_file;
+  /* 0 to open the directory */
+  guint n_files;
 };
 
 static void peas_engine_load_plugin_real   (PeasEngine     *engine,
@@ -100,68 +183,306 @@ static void peas_engine_unload_plugin_real (PeasEngine     *engine,
                                             PeasPluginInfo *info);
 
 static void
-load_plugin_info (PeasEngine  *engine,
-                  const gchar *filename,
-                  const gchar *module_dir,
-                  const gchar *data_dir)
+add_plugin_info (PeasEngine     *engine,
+                 PeasPluginInfo *info)
 {
-  PeasPluginInfo *info;
   const gchar *module_name;
+  guint i;
 
-  info = _peas_plugin_info_new (filename,
-                                module_dir,
-                                data_dir);
-
-  if (info == NULL)
+  /* If a plugin with this name has already been loaded
+   * drop this one (user plugins override system plugins) */
+  module_name = peas_plugin_info_get_module_name (info);
+  if (g_hash_table_lookup (engine->priv->plugin_names, module_name) != NULL)
     {
-      g_warning ("Error loading '%s'", filename);
+      _peas_plugin_info_unref (info);
       return;
     }
 
-  /* If a plugin with this name has already been loaded
-   * drop this one (user plugins override system plugins) */
-  module_name = peas_plugin_info_get_module_name (info);
-  if (peas_engine_get_plugin_info (engine, module_name) != NULL)
-    _peas_plugin_info_unref (info);
-  else
-    engine->priv->plugin_list = g_list_prepend (engine->priv->plugin_list, info);
+  engine->priv->plugin_list = g_list_prepend (engine->priv->plugin_list, info);
+  g_hash_table_insert (engine->priv->plugin_names, (gpointer) module_name, info);
+
+  if (engine->priv->topological_order != NULL)
+    {
+      g_ptr_array_free (engine->priv->topological_order, TRUE);
+      engine->priv->topological_order = NULL;
+    }
+
+  for (i = 0; info->dependencies[i] != NULL; i++)
+    {
+      GList *dependents;
+
+      dependents = g_hash_table_lookup (engine->priv->dependents,
+                                        info->dependencies[i]);
+
+      /* Appending keeps the head of the list, which is stored in the table */
+      if (dependents == NULL)
+        g_hash_table_insert (engine->priv->dependents, info->dependencies[i],
+                             g_list_prepend (NULL, info));
+      else if (g_list_find (dependents, info) == NULL)
+        g_list_append (dependents, info);
+    }
+
+  if (info->extension_types == NULL)
+    return;
+
+  for (i = 0; info->extension_types[i] != NULL; i++)
+    {
+      GList *providers;
+
+      providers = g_hash_table_lookup (engine->priv->extension_types,
+                                       info->extension_types[i]);
+
+      if (providers == NULL)
+        g_hash_table_insert (engine->priv->extension_types,
+                             info->extension_types[i],
+                             g_list_prepend (NULL, info));
+      else if (g_list_find (providers, info) == NULL)
+        g_list_append (providers, info);
+    }
 }
 
 static void
-load_dir_real (PeasEngine  *engine,
-               const gchar *module_dir,
-               const gchar *data_dir,
-               guint        recursions)
+load_dir_real (PeasEngine      *engine,
+               PeasPluginCache *cache,
+               const gchar     *module_dir,
+               const gchar     *data_dir,
+               guint            recursions)
 {
-  GError *error = NULL;
-  GDir *d;
-  const gchar *dirent;
+  GPtrArray *infos;
+  GPtrArray *subdirs;
+  guint i;
 
   g_debug ("Loading %s/*.plugin...", module_dir);
 
-  d = g_dir_open (module_dir, 0, &error);
+  PEAS_TRACE_BEGIN ("load_dir_real", module_dir);
+
+  infos = g_ptr_array_new ();
+  subdirs = g_ptr_array_new ();
 
-  if (!d)
+  _peas_plugin_cache_read_dir (cache, module_dir, data_dir, recursions > 0,
+                               infos, subdirs);
+
+  for (i = 0; i < infos->len; i++)
+    add_plugin_info (engine, (PeasPluginInfo *) g_ptr_array_index (infos, i));
+
+  for (i = 0; i < subdirs->len; i++)
     {
-      g_debug ("%s", error->message);
-      g_error_free (error);
-      return;
+      gchar *subdir = (gchar *) g_ptr_array_index (subdirs, i);
+
+      load_dir_real (engine, cache, subdir, data_dir, recursions - 1);
+      g_free (subdir);
+    }
+
+  g_ptr_array_free (infos, TRUE);
+  g_ptr_array_free (subdirs, TRUE);
+
+  PEAS_TRACE_END ("load_dir_real", module_dir);
+}
+
+static ScanNode *
+scan_node_new (PeasPluginCache *cache,
+               gchar           *module_dir,
+               const gchar     *data_dir,
+               guint            recursions)
+{
+  ScanNode *node;
+
+  node = g_slice_new0 (ScanNode);
+  node->cache = cache;
+  node->module_dir = module_dir;
+  node->data_dir = data_dir;
+  node->recursions = recursions;
+  node->children = g_ptr_array_new ();
+
+  return node;
+}
+
+static void
+scan_push_job (ParallelScan *scan,
+               ScanNode     *node,
+               guint         first_file,
+               guint         n_files)
+{
+  ScanJob *job;
+
+  job = g_slice_new (ScanJob);
+  job->node = node;
+  job->first_file = first_file;
+  job->n_files = n_files;
+
+  g_mutex_lock (scan->lock);
+  scan->n_pending++;
+  g_mutex_unlock (scan->lock);
+
+  g_thread_pool_push (scan->pool, job, NULL);
+}
+
+static void
+scan_worker (ScanJob      *job,
+             ParallelScan *scan)
+{
+  ScanNode *node = job->node;
+  guint i;
+
+  PEAS_TRACE_BEGIN ("scan_worker", node->module_dir);
+
+  if (job->n_files == 0)
+    {
+      g_debug ("Loading %s/*.plugin...", node->module_dir);
+
+      node->dir = _peas_plugin_cache_open_dir (node->cache,
+                                               node->module_dir,
+                                               node->data_dir,
+                                               node->recursions > 0);
+
+      if (node->dir != NULL)
+        {
+          GPtrArray *subdirs;
+          guint n_files;
+
+          n_files = _peas_plugin_cache_dir_get_n_files (node->dir);
+          for (i = 0; i < n_files; i += SCAN_FILES_PER_JOB)
+            scan_push_job (scan, node, i, MIN (SCAN_FILES_PER_JOB, n_files - i));
+
+          /* The children only belong to this job */
+          subdirs = g_ptr_array_new ();
+          _peas_plugin_cache_dir_get_subdirs (node->dir, subdirs);
+
+          for (i = 0; i < subdirs->len; i++)
+            {
+              ScanNode *child;
+
+              child = scan_node_new (node->cache,
+                                     (gchar *) g_ptr_array_index (subdirs, i),
+                                     node->data_dir, node->recursions - 1);
+              g_ptr_array_add (node->children, child);
+              scan_push_job (scan, child, 0, 0);
+            }
+
+          g_ptr_array_free (subdirs, TRUE);
+        }
+    }
+  else
+    {
+      for (i = job->first_file; i < job->first_file + job->n_files; i++)
+        _peas_plugin_cache_dir_load_file (node->cache, node->dir, i);
+    }
+
+  PEAS_TRACE_END ("scan_worker", node->module_dir);
+
+  g_slice_free (ScanJob, job);
+
+  g_mutex_lock (scan->lock);
+  if (--scan->n_pending == 0)
+    g_cond_signal (scan->cond);
+  g_mutex_unlock (scan->lock);
+}
+
+static void
+merge_scan_node (PeasEngine *engine,
+                 ScanNode   *node)
+{
+  guint i;
+
+  if (node->dir != NULL)
+    {
+      GPtrArray *infos;
+
+      infos = g_ptr_array_new ();
+      _peas_plugin_cache_close_dir (node->cache, node->dir, infos);
+
+      for (i = 0; i < infos->len; i++)
+        add_plugin_info (engine, (PeasPluginInfo *) g_ptr_array_index (infos, i));
+
+      g_ptr_array_free (infos, TRUE);
+    }
+
+  for (i = 0; i < node->children->len; i++)
+    merge_scan_node (engine, (ScanNode *) g_ptr_array_index (node->children, i));
+
+  g_ptr_array_free (node->children, TRUE);
+  g_free (node->module_dir);
+  g_slice_free (ScanNode, node);
+}
+
+static void
+load_search_paths_parallel (PeasEngine *engine,
+                            GList      *search_paths)
+{
+  ParallelScan scan;
+  GPtrArray *roots;
+  GList *item;
+  guint i;
+
+  scan.pool = g_thread_pool_new ((GFunc) scan_worker, &scan,
+                                 SCAN_MAX_THREADS, FALSE, NULL);
+  scan.lock = g_mutex_new ();
+  scan.cond = g_cond_new ();
+  scan.n_pending = 0;
+
+  roots = g_ptr_array_new ();
+
+  for (item = search_paths; item != NULL; item = item->next)
+    {
+      SearchPath *sp = (SearchPath *) item->data;
+      ScanNode *root;
+
+      root = scan_node_new (_peas_plugin_cache_new (sp->module_dir),
+                            g_strdup (sp->module_dir), sp->data_dir, 1);
+      g_ptr_array_add (roots, root);
+      scan_push_job (&scan, root, 0, 0);
     }
 
-  while ((dirent = g_dir_read_name (d)))
+  g_mutex_lock (scan.lock);
+  while (scan.n_pending > 0)
+    g_cond_wait (scan.cond, scan.lock);
+  g_mutex_unlock (scan.lock);
+
+  g_thread_pool_free (scan.pool, FALSE, TRUE);
+  g_cond_free (scan.cond);
+  g_mutex_free (scan.lock);
+
+  /* Merge in the search path order so the first search paths still
+   * take precedence (user plugins override system plugins) */
+  for (i = 0; i < roots->len; i++)
     {
-      gchar *filename = g_build_filename (module_dir, dirent, NULL);
+      ScanNode *root = (ScanNode *) g_ptr_array_index (roots, i);
+      PeasPluginCache *cache = root->cache;
+
+      merge_scan_node (engine, root);
 
-      if (g_str_has_suffix (dirent, ".plugin"))
-        load_plugin_info (engine, filename, module_dir, data_dir);
+      _peas_plugin_cache_save (cache);
+      _peas_plugin_cache_free (cache);
+    }
+
+  g_ptr_array_free (roots, TRUE);
+}
 
-      else if (recursions > 0 && g_file_test (filename, G_FILE_TEST_IS_DIR))
-        load_dir_real (engine, filename, data_dir, recursions - 1);
+static void
+load_search_paths (PeasEngine *engine,
+                   GList      *search_paths)
+{
+  GList *item;
 
-      g_free (filename);
+  /* Initializing the thread system is up to the application */
+  if (engine->priv->parallel_scan && g_thread_supported ())
+    {
+      load_search_paths_parallel (engine, search_paths);
+      return;
     }
 
-  g_dir_close (d);
+  for (item = search_paths; item != NULL; item = item->next)
+    {
+      SearchPath *sp = (SearchPath *) item->data;
+      PeasPluginCache *cache;
+
+      cache = _peas_plugin_cache_new (sp->module_dir);
+
+      load_dir_real (engine, cache, sp->module_dir, sp->data_dir, 1);
+
+      _peas_plugin_cache_save (cache);
+      _peas_plugin_cache_free (cache);
+    }
 }
 
 /**
@@ -177,8 +498,6 @@ load_dir_real (PeasEngine  *engine,
 void
 peas_engine_rescan_plugins (PeasEngine *engine)
 {
-  GList *item;
-
   g_return_if_fail (PEAS_IS_ENGINE (engine));
 
   if (engine->priv->search_paths == NULL)
@@ -188,11 +507,7 @@ peas_engine_rescan_plugins (PeasEngine *engine)
     }
 
   /* Go and read everything from the provided search paths */
-  for (item = engine->priv->search_paths; item != NULL; item = item->next)
-    {
-      SearchPath *sp = (SearchPath *) item->data;
-      load_dir_real (engine, sp->module_dir, sp->data_dir, 1);
-    }
+  load_search_paths (engine, engine->priv->search_paths);
 
   g_object_notify (G_OBJECT (engine), "plugin-list");
 }
@@ -238,7 +553,7 @@ peas_engine_add_search_path (PeasEngine *engine,
    * the plugin list. */
   engine->priv->search_paths = g_list_append (engine->priv->search_paths, sp);
 
-  load_dir_real (engine, sp->module_dir, sp->data_dir, 1);
+  load_search_paths (engine, g_list_last (engine->priv->search_paths));
   g_object_notify (G_OBJECT (engine), "plugin-list");
 }
 
@@ -309,6 +624,31 @@ peas_engine_init (PeasEngine *engine)
                                               PEAS_TYPE_ENGINE,
                                               PeasEnginePrivate);
 
+  /* mapping from module name -> plugin info, the names belong to the infos */
+  engine->priv->plugin_names = g_hash_table_new (g_str_hash, g_str_equal);
+
+  /* mapping from module name -> dependent plugin infos, dependencies are
+   * matched case-insensitively like peas_plugin_info_has_dependency() */
+  engine->priv->dependents = g_hash_table_new_full (hash_lowercase,
+                                                    (GEqualFunc) equal_lowercase,
+                                                    NULL,
+                                                    (GDestroyNotify) g_list_free);
+
+  /* mapping from extension type name -> plugin infos declaring it,
+   * the names belong to the infos */
+  engine->priv->extension_types = g_hash_table_new_full (g_str_hash,
+                                                         g_str_equal,
+                                                         NULL,
+                                                         (GDestroyNotify) g_list_free);
+
+  engine->priv->changed_plugins = g_hash_table_new (g_direct_hash,
+                                                    g_direct_equal);
+
+  /* mapping from fingerprint -> shared extension, the fingerprints
+   * belong to the shared extensions */
+  engine->priv->shared_extensions = g_hash_table_new (g_str_hash,
+                                                      g_str_equal);
+
   /* mapping from loadername -> loader object */
   engine->priv->loaders = g_hash_table_new_full (hash_lowercase,
                                                  (GEqualFunc) equal_lowercase,
@@ -361,6 +701,12 @@ peas_engine_set_property (GObject      *object,
       peas_engine_set_loaded_plugins (engine,
                                       (const gchar **) g_value_get_boxed (value));
       break;
+    case PROP_PARALLEL_SCAN:
+      engine->priv->parallel_scan = g_value_get_boolean (value);
+      break;
+    case PROP_PREFETCH_PLUGINS:
+      engine->priv->prefetch_plugins = g_value_get_boolean (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -385,12 +731,73 @@ peas_engine_get_property (GObject    *object,
       g_value_take_boxed (value,
                           (gconstpointer) peas_engine_get_loaded_plugins (engine));
       break;
+    case PROP_PARALLEL_SCAN:
+      g_value_set_boolean (value, engine->priv->parallel_scan);
+      break;
+    case PROP_PREFETCH_PLUGINS:
+      g_value_set_boolean (value, engine->priv->prefetch_plugins);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
     }
 }
 
+static void shared_extension_finalized (SharedExtension *shared,
+                                        GObject         *where_the_object_was);
+
+/* Drops the weak references, but the one of @finalized which is gone */
+static void
+free_shared_extension (SharedExtension *shared,
+                       GObject         *finalized)
+{
+  guint i;
+
+  if (G_OBJECT (shared->exten) != finalized)
+    g_object_weak_unref (G_OBJECT (shared->exten),
+                         (GWeakNotify) shared_extension_finalized, shared);
+
+  for (i = 0; i < shared->objects->len; i++)
+    {
+      GObject *object = g_ptr_array_index (shared->objects, i);
+
+      if (object != finalized)
+        g_object_weak_unref (object,
+                             (GWeakNotify) shared_extension_finalized, shared);
+    }
+
+  g_ptr_array_free (shared->objects, TRUE);
+  g_free (shared->fingerprint);
+  g_slice_free (SharedExtension, shared);
+}
+
+/* Called for the extension and for the objects passed as parameters,
+ * as another object could get the same address and must not be given
+ * the extension created for this one */
+static void
+shared_extension_finalized (SharedExtension *shared,
+                            GObject         *where_the_object_was)
+{
+  g_hash_table_remove (shared->engine->priv->shared_extensions,
+                       shared->fingerprint);
+  free_shared_extension (shared, where_the_object_was);
+}
+
+/* Stops sharing the extensions of @info, or all of them if it is NULL.
+ * The extensions themselves stay alive as long as they are used. */
+static gboolean
+forget_shared_extension (const gchar     *fingerprint,
+                         SharedExtension *shared,
+                         PeasPluginInfo  *info)
+{
+  if (info != NULL && shared->info != info)
+    return FALSE;
+
+  free_shared_extension (shared, NULL);
+
+  return TRUE;
+}
+
 static void
 peas_engine_finalize (GObject *object)
 {
@@ -406,10 +813,23 @@ peas_engine_finalize (GObject *object)
         peas_engine_unload_plugin_real (engine, info);
     }
 
+  g_hash_table_foreach_remove (engine->priv->shared_extensions,
+                               (GHRFunc) forget_shared_extension, NULL);
+  g_hash_table_destroy (engine->priv->shared_extensions);
+
   /* unref the loaders */
   g_hash_table_destroy (engine->priv->loaders);
 
   /* and finally free the infos */
+  g_hash_table_destroy (engine->priv->plugin_names);
+  g_hash_table_destroy (engine->priv->changed_plugins);
+  g_list_free (engine->priv->changed_plugins_order);
+  g_hash_table_destroy (engine->priv->dependents);
+  g_hash_table_destroy (engine->priv->extension_types);
+
+  if (engine->priv->topological_order != NULL)
+    g_ptr_array_free (engine->priv->topological_order, TRUE);
+
   for (item = engine->priv->plugin_list; item; item = item->next)
     _peas_plugin_info_unref (PEAS_PLUGIN_INFO (item->data));
 
@@ -488,6 +908,59 @@ peas_engine_class_init (PeasEngineClass *klass)
                                                        G_PARAM_READWRITE |
                                                        G_PARAM_STATIC_STRINGS));
 
+  /**
+   * PeasEngine:parallel-scan:
+   *
+   * Whether the plugin directories are scanned using a pool of threads.
+   *
+   * When this is set, the directories of the search paths are listed and
+   * their plugin info files are parsed concurrently, which mostly helps
+   * when they are on a slow file system. The resulting plugin list is the
+   * same as with a serial scan.
+   *
+   * This affects the next calls to peas_engine_rescan_plugins() and
+   * peas_engine_add_search_path().
+   *
+   * The engine does not initialize the thread system: the application
+   * must call g_thread_init() itself, before using any other GLib
+   * function. Otherwise the directories are scanned serially.
+   */
+  g_object_class_install_property (object_class,
+                                   PROP_PARALLEL_SCAN,
+                                   g_param_spec_boolean ("parallel-scan",
+                                                         "Parallel scan",
+                                                         "Whether to scan the plugin directories using threads",
+                                                         FALSE,
+                                                         G_PARAM_READWRITE |
+                                                         G_PARAM_STATIC_STRINGS));
+
+  /**
+   * PeasEngine:prefetch-plugins:
+   *
+   * Whether peas_engine_set_loaded_plugins() prefetches the plugins to
+   * load using a pool of threads.
+   *
+   * When this is set, the blocking parts of loading the plugins, like
+   * opening the shared libraries, are done concurrently for the plugins
+   * which do not depend on each other, before any plugin is unloaded.
+   * This costs a thread pool for each call, so it only pays off when
+   * many plugins are loaded at once.
+   *
+   * The engine does not initialize the thread system: the application
+   * must call g_thread_init() itself, before using any other GLib
+   * function. Otherwise nothing is prefetched.
+   *
+   * peas_engine_load_plugins_async() always prefetches the plugins.
+   */
+  g_object_class_install_property (object_class,
+                                   PROP_PREFETCH_PLUGINS,
+                                   g_param_spec_boolean ("prefetch-plugins",
+                                                         "Prefetch plugins",
+                                                         "Whether to prefetch the plugins to load using threads",
+                                                         FALSE,
+                                                         G_PARAM_READWRITE |
+                                                         G_PARAM_STATIC_STRINGS));
+
   /**
    * PeasEngine::load-plugin:
    * @engine: A #PeasEngine.
@@ -537,6 +1010,31 @@ peas_engine_class_init (PeasEngineClass *klass)
                   1, PEAS_TYPE_PLUGIN_INFO |
                   G_SIGNAL_TYPE_STATIC_SCOPE);
 
+  /**
+   * PeasEngine::loaded-plugins-changed:
+   * @engine: A #PeasEngine.
+   * @plugins: (element-type Peas.PluginInfo): the list of the
+   *   #PeasPluginInfo<!-- -->s which were loaded or unloaded.
+   *
+   * The loaded-plugins-changed signal is emitted once the outermost
+   * transaction is committed, see peas_engine_begin_transaction(), with all
+   * the plugins whose state changed during the transaction. A single call to
+   * peas_engine_load_plugin() or peas_engine_unload_plugin() is a transaction
+   * on its own, so this signal also lists the plugins which were loaded or
+   * unloaded along with it because of their dependencies.
+   *
+   * The list is only valid during the emission.
+   */
+  signals[LOADED_PLUGINS_CHANGED] =
+    g_signal_new ("loaded-plugins-changed",
+                  the_type,
+                  G_SIGNAL_RUN_LAST,
+                  0,
+                  NULL, NULL,
+                  g_cclosure_marshal_VOID__POINTER,
+                  G_TYPE_NONE,
+                  1, G_TYPE_POINTER);
+
   g_type_class_add_private (klass, sizeof (PeasEnginePrivate));
 
   /* We are doing some global initialization here as there is currently no
@@ -638,7 +1136,11 @@ get_plugin_loader (PeasEngine     *engine,
                                                     loader_id);
 
   if (loader_info == NULL)
-    loader_info = load_plugin_loader (engine, loader_id);
+    {
+      PEAS_TRACE_BEGIN ("load_plugin_loader", loader_id);
+      loader_info = load_plugin_loader (engine, loader_id);
+      PEAS_TRACE_END ("load_plugin_loader", loader_id);
+    }
 
   return loader_info->loader;
 }
@@ -696,13 +1198,6 @@ peas_engine_get_plugin_list (PeasEngine *engine)
   return engine->priv->plugin_list;
 }
 
-static gint
-compare_plugin_info_and_name (PeasPluginInfo *info,
-                              const gchar    *module_name)
-{
-  return strcmp (peas_plugin_info_get_module_name (info), module_name);
-}
-
 /**
  * peas_engine_get_plugin_info:
  * @engine: A #PeasEngine.
@@ -715,46 +1210,248 @@ PeasPluginInfo *
 peas_engine_get_plugin_info (PeasEngine  *engine,
                              const gchar *plugin_name)
 {
-  GList *l = g_list_find_custom (engine->priv->plugin_list,
-                                 plugin_name,
-                                 (GCompareFunc) compare_plugin_info_and_name);
+  g_return_val_if_fail (PEAS_IS_ENGINE (engine), NULL);
+  g_return_val_if_fail (plugin_name != NULL, NULL);
 
-  return l == NULL ? NULL : (PeasPluginInfo *) l->data;
+  return (PeasPluginInfo *) g_hash_table_lookup (engine->priv->plugin_names,
+                                                 plugin_name);
 }
 
-static gboolean
-load_plugin (PeasEngine     *engine,
-             PeasPluginInfo *info)
+/**
+ * peas_engine_get_dependents:
+ * @engine: A #PeasEngine.
+ * @info: A #PeasPluginInfo.
+ *
+ * Returns the list of the plugins known to @engine which depend on @info,
+ * that is the plugins which will be unloaded when @info is unloaded.
+ *
+ * This list is updated when new plugins are found by
+ * peas_engine_rescan_plugins() or peas_engine_add_search_path().
+ *
+ * Returns: (transfer none) (element-type Peas.PluginInfo): the list of
+ * #PeasPluginInfo depending on @info, which belongs to the engine and
+ * should not be modified or freed.
+ */
+const GList *
+peas_engine_get_dependents (PeasEngine     *engine,
+                            PeasPluginInfo *info)
 {
-  const gchar **dependencies;
-  PeasPluginInfo *dep_info;
-  guint i;
-  PeasPluginLoader *loader;
-
-  if (peas_plugin_info_is_loaded (info))
-    return TRUE;
+  g_return_val_if_fail (PEAS_IS_ENGINE (engine), NULL);
+  g_return_val_if_fail (info != NULL, NULL);
 
-  if (!peas_plugin_info_is_available (info))
-    return FALSE;
+  return (const GList *) g_hash_table_lookup (engine->priv->dependents,
+                                              peas_plugin_info_get_module_name (info));
+}
 
-  /* We set the plugin info as loaded before trying to load the dependencies,
-   * to make sure we won't have an infinite loop. */
-  info->loaded = TRUE;
+/**
+ * peas_engine_get_plugins_for_extension_type:
+ * @engine: A #PeasEngine.
+ * @extension_type: An extension #GType.
+ *
+ * Returns the list of the plugins known to @engine which declare that they
+ * implement @extension_type, without loading any of them. See
+ * peas_plugin_info_get_extension_types().
+ *
+ * Plugins which do not declare their extension types are not part of this
+ * list, even if they implement @extension_type.
+ *
+ * Returns: (transfer none) (element-type Peas.PluginInfo): the list of
+ * #PeasPluginInfo declaring @extension_type, which belongs to the engine
+ * and should not be modified or freed.
+ */
+const GList *
+peas_engine_get_plugins_for_extension_type (PeasEngine *engine,
+                                            GType       extension_type)
+{
+  g_return_val_if_fail (PEAS_IS_ENGINE (engine), NULL);
+  g_return_val_if_fail (extension_type != G_TYPE_INVALID, NULL);
 
-  dependencies = peas_plugin_info_get_dependencies (info);
-  for (i = 0; dependencies[i] != NULL; i++)
-    {
-      dep_info = peas_engine_get_plugin_info (engine, dependencies[i]);
-      if (!dep_info)
-        {
-          g_warning ("Plugin not found: %s", dependencies[i]);
-          goto error;
-        }
+  return (const GList *) g_hash_table_lookup (engine->priv->extension_types,
+                                              g_type_name (extension_type));
+}
 
-      if (!peas_engine_load_plugin (engine, dep_info))
+/**
+ * peas_engine_begin_transaction:
+ * @engine: A #PeasEngine.
+ *
+ * Starts a transaction, allowing to load and unload a set of plugins
+ * with a single notification.
+ *
+ * Until the matching call to peas_engine_commit_transaction(), the
+ * #PeasEngine:loaded-plugins notification is held back, and emitted only
+ * once if plugins were loaded or unloaded. The
+ * #PeasEngine::loaded-plugins-changed signal is then emitted with all the
+ * plugins whose state changed.
+ *
+ * Transactions can be nested, only the outermost one is committed.
+ */
+void
+peas_engine_begin_transaction (PeasEngine *engine)
+{
+  g_return_if_fail (PEAS_IS_ENGINE (engine));
+
+  if (engine->priv->transaction_depth++ == 0)
+    g_object_freeze_notify (G_OBJECT (engine));
+}
+
+/**
+ * peas_engine_commit_transaction:
+ * @engine: A #PeasEngine.
+ *
+ * Ends a transaction started with peas_engine_begin_transaction(), emitting
+ * the held back notifications if this was the outermost transaction.
+ */
+void
+peas_engine_commit_transaction (PeasEngine *engine)
+{
+  PeasEnginePrivate *priv;
+  GList *changed = NULL;
+  GList *item;
+
+  g_return_if_fail (PEAS_IS_ENGINE (engine));
+
+  priv = engine->priv;
+
+  g_return_if_fail (priv->transaction_depth > 0);
+
+  if (--priv->transaction_depth > 0)
+    return;
+
+  priv->changed_plugins_order = g_list_reverse (priv->changed_plugins_order);
+
+  for (item = priv->changed_plugins_order; item; item = item->next)
+    {
+      PeasPluginInfo *info = (PeasPluginInfo *) item->data;
+      gboolean was_loaded;
+
+      was_loaded = GPOINTER_TO_INT (g_hash_table_lookup (priv->changed_plugins, info)) - 1;
+
+      if (was_loaded != peas_plugin_info_is_loaded (info))
+        changed = g_list_prepend (changed, info);
+    }
+
+  /* Handlers can start new transactions */
+  g_list_free (priv->changed_plugins_order);
+  priv->changed_plugins_order = NULL;
+  g_hash_table_remove_all (priv->changed_plugins);
+
+  if (changed != NULL)
+    {
+      changed = g_list_reverse (changed);
+      g_signal_emit (engine, signals[LOADED_PLUGINS_CHANGED], 0, changed);
+      g_list_free (changed);
+    }
+
+  g_object_thaw_notify (G_OBJECT (engine));
+}
+
+static void
+record_plugin_change (PeasEngine     *engine,
+                      PeasPluginInfo *info)
+{
+  PeasEnginePrivate *priv = engine->priv;
+
+  if (priv->transaction_depth == 0 ||
+      g_hash_table_lookup (priv->changed_plugins, info) != NULL)
+    return;
+
+  g_hash_table_insert (priv->changed_plugins, info,
+                       GINT_TO_POINTER (peas_plugin_info_is_loaded (info) + 1));
+  priv->changed_plugins_order = g_list_prepend (priv->changed_plugins_order,
+                                                info);
+}
+
+static void
+topological_visit (PeasEngine     *engine,
+                   PeasPluginInfo *info,
+                   GHashTable     *visited,
+                   GPtrArray      *order)
+{
+  guint i;
+
+  /* Also stops dependency cycles */
+  if (g_hash_table_lookup (visited, info) != NULL)
+    return;
+
+  g_hash_table_insert (visited, info, info);
+
+  for (i = 0; info->dependencies[i] != NULL; i++)
+    {
+      PeasPluginInfo *dep_info;
+
+      dep_info = g_hash_table_lookup (engine->priv->plugin_names,
+                                      info->dependencies[i]);
+
+      if (dep_info != NULL)
+        topological_visit (engine, dep_info, visited, order);
+    }
+
+  g_ptr_array_add (order, info);
+}
+
+/* Returns all the plugins, each one after its dependencies */
+static GPtrArray *
+get_topological_order (PeasEngine *engine)
+{
+  GHashTable *visited;
+  GList *item;
+
+  if (engine->priv->topological_order != NULL)
+    return engine->priv->topological_order;
+
+  engine->priv->topological_order = g_ptr_array_new ();
+  visited = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+  for (item = engine->priv->plugin_list; item != NULL; item = item->next)
+    topological_visit (engine, (PeasPluginInfo *) item->data, visited,
+                       engine->priv->topological_order);
+
+  g_hash_table_destroy (visited);
+
+  return engine->priv->topological_order;
+}
+
+static gboolean
+load_plugin (PeasEngine     *engine,
+             PeasPluginInfo *info)
+{
+  const gchar **dependencies;
+  PeasPluginInfo *dep_info;
+  guint i;
+  PeasPluginLoader *loader;
+
+  if (peas_plugin_info_is_loaded (info))
+    return TRUE;
+
+  if (!peas_plugin_info_is_available (info))
+    return FALSE;
+
+  /* We set the plugin info as loaded before trying to load the dependencies,
+   * to make sure we won't have an infinite loop. */
+  info->loaded = TRUE;
+
+  dependencies = peas_plugin_info_get_dependencies (info);
+  for (i = 0; dependencies[i] != NULL; i++)
+    {
+      dep_info = peas_engine_get_plugin_info (engine, dependencies[i]);
+      if (!dep_info)
+        {
+          g_warning ("Plugin not found: %s", dependencies[i]);
+          goto error;
+        }
+
+      if (!peas_engine_load_plugin (engine, dep_info))
         goto error;
     }
 
+  /* Plugins declaring their extension types are only loaded by their
+   * loader once one of those extensions is requested */
+  if (info->extension_types != NULL)
+    {
+      info->deferred = TRUE;
+      return TRUE;
+    }
+
   loader = get_plugin_loader (engine, info);
 
   if (loader == NULL)
@@ -784,6 +1481,8 @@ static void
 peas_engine_load_plugin_real (PeasEngine     *engine,
                               PeasPluginInfo *info)
 {
+  record_plugin_change (engine, info);
+
   if (load_plugin (engine, info))
     g_object_notify (G_OBJECT (engine), "loaded-plugins");
 }
@@ -811,7 +1510,9 @@ peas_engine_load_plugin (PeasEngine     *engine,
   if (peas_plugin_info_is_loaded (info))
     return TRUE;
 
+  peas_engine_begin_transaction (engine);
   g_signal_emit (engine, signals[LOAD_PLUGIN], 0, info);
+  peas_engine_commit_transaction (engine);
 
   return peas_plugin_info_is_loaded (info);
 }
@@ -820,36 +1521,45 @@ static void
 peas_engine_unload_plugin_real (PeasEngine     *engine,
                                 PeasPluginInfo *info)
 {
-  GList *item;
-  const gchar *module_name;
+  const GList *item;
   PeasPluginLoader *loader;
 
   if (!peas_plugin_info_is_loaded (info) ||
       !peas_plugin_info_is_available (info))
     return;
 
+  record_plugin_change (engine, info);
+
   /* We set the plugin info as unloaded before trying to unload the
    * dependants, to make sure we won't have an infinite loop. */
   info->loaded = FALSE;
 
+  /* Extensions still alive must not be handed out once it is reloaded */
+  g_hash_table_foreach_remove (engine->priv->shared_extensions,
+                               (GHRFunc) forget_shared_extension, info);
+
   /* First unload all the dependant plugins */
-  module_name = peas_plugin_info_get_module_name (info);
-  for (item = engine->priv->plugin_list; item; item = item->next)
+  for (item = peas_engine_get_dependents (engine, info); item; item = item->next)
     {
       PeasPluginInfo *other_info = PEAS_PLUGIN_INFO (item->data);
 
-      if (!peas_plugin_info_is_loaded (other_info))
-        continue;
-
-      if (peas_plugin_info_has_dependency (other_info, module_name))
-         peas_engine_unload_plugin (engine, other_info);
+      if (peas_plugin_info_is_loaded (other_info))
+        peas_engine_unload_plugin (engine, other_info);
     }
 
-  /* find the loader and tell it to gc and unload the plugin */
-  loader = get_plugin_loader (engine, info);
+  if (info->deferred)
+    {
+      /* The loader never loaded it */
+      info->deferred = FALSE;
+    }
+  else
+    {
+      /* find the loader and tell it to gc and unload the plugin */
+      loader = get_plugin_loader (engine, info);
 
-  peas_plugin_loader_garbage_collect (loader);
-  peas_plugin_loader_unload (loader, info);
+      peas_plugin_loader_garbage_collect (loader);
+      peas_plugin_loader_unload (loader, info);
+    }
 
   g_object_notify (G_OBJECT (engine), "loaded-plugins");
 }
@@ -874,11 +1584,65 @@ peas_engine_unload_plugin (PeasEngine     *engine,
   if (!peas_plugin_info_is_loaded (info))
     return TRUE;
 
+  peas_engine_begin_transaction (engine);
   g_signal_emit (engine, signals[UNLOAD_PLUGIN], 0, info);
+  peas_engine_commit_transaction (engine);
 
   return !peas_plugin_info_is_loaded (info);
 }
 
+static gboolean
+declares_extension_type (PeasPluginInfo *info,
+                         GType           extension_type)
+{
+  const gchar *type_name;
+  guint i;
+
+  type_name = g_type_name (extension_type);
+  if (type_name == NULL)
+    return FALSE;
+
+  for (i = 0; info->extension_types[i] != NULL; i++)
+    {
+      if (strcmp (info->extension_types[i], type_name) == 0)
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+/* Asks the loader to load a plugin whose loading was deferred until
+ * one of its extensions was requested. */
+static gboolean
+activate_deferred_plugin (PeasEngine     *engine,
+                          PeasPluginInfo *info)
+{
+  PeasPluginLoader *loader;
+
+  loader = get_plugin_loader (engine, info);
+
+  if (loader == NULL)
+    {
+      g_warning ("Could not find loader '%s' for plugin '%s'",
+                 info->loader, info->name);
+    }
+  else if (peas_plugin_loader_load (loader, info))
+    {
+      info->deferred = FALSE;
+      return TRUE;
+    }
+  else
+    {
+      g_warning ("Error loading plugin '%s'", info->name);
+    }
+
+  /* It cannot stay loaded, and neither can its dependents */
+  peas_engine_unload_plugin (engine, info);
+  info->available = FALSE;
+
+  return FALSE;
+}
+
 gboolean
 peas_engine_provides_extension (PeasEngine     *engine,
                                 PeasPluginInfo *info,
@@ -892,6 +1656,10 @@ peas_engine_provides_extension (PeasEngine     *engine,
   if (!peas_plugin_info_is_loaded (info))
     return FALSE;
 
+  /* Answer without loading the plugin */
+  if (info->deferred)
+    return declares_extension_type (info, extension_type);
+
   loader = get_plugin_loader (engine, info);
   return peas_plugin_loader_provides_extension (loader, info, extension_type);
 }
@@ -921,13 +1689,225 @@ peas_engine_create_extensionv (PeasEngine     *engine,
                                GParameter     *parameters)
 {
   PeasPluginLoader *loader;
+  PeasExtension *exten = NULL;
 
   g_return_val_if_fail (PEAS_IS_ENGINE (engine), NULL);
   g_return_val_if_fail (info != NULL, NULL);
 
-  loader = get_plugin_loader (engine, info);
-  return peas_plugin_loader_create_extension (loader, info, extension_type,
-                                              n_parameters, parameters);
+  if (info->deferred && !declares_extension_type (info, extension_type))
+    return NULL;
+
+  PEAS_TRACE_BEGIN ("create_extension", info->module_name);
+
+  if (!info->deferred || activate_deferred_plugin (engine, info))
+    {
+      loader = get_plugin_loader (engine, info);
+      exten = peas_plugin_loader_create_extension (loader, info,
+                                                   extension_type,
+                                                   n_parameters, parameters);
+    }
+
+  PEAS_TRACE_END ("create_extension", info->module_name);
+
+  return exten;
+}
+
+static gint
+compare_strings (gconstpointer a,
+                 gconstpointer b)
+{
+  return strcmp (*((const gchar **) a), *((const gchar **) b));
+}
+
+/* The whole content of @value as a string, or %NULL if it can only be
+ * told apart by address, as pointers and boxed values, which can be
+ * reused by another value once they are freed. Objects are told apart
+ * by address too, they are added to @objects to be watched. */
+static gchar *
+value_fingerprint (const GValue *value,
+                   GPtrArray    *objects)
+{
+  GObject *object;
+  guint i;
+  gchar buffer[G_ASCII_DTOSTR_BUF_SIZE];
+
+  if (G_VALUE_TYPE (value) == G_TYPE_STRV)
+    return g_strdup_value_contents (value);
+
+  switch (G_TYPE_FUNDAMENTAL (G_VALUE_TYPE (value)))
+    {
+    case G_TYPE_CHAR:
+    case G_TYPE_UCHAR:
+    case G_TYPE_BOOLEAN:
+    case G_TYPE_INT:
+    case G_TYPE_UINT:
+    case G_TYPE_LONG:
+    case G_TYPE_ULONG:
+    case G_TYPE_INT64:
+    case G_TYPE_UINT64:
+    case G_TYPE_ENUM:
+    case G_TYPE_FLAGS:
+    case G_TYPE_STRING:
+      return g_strdup_value_contents (value);
+    /* g_strdup_value_contents() rounds them */
+    case G_TYPE_FLOAT:
+      return g_strdup (g_ascii_dtostr (buffer, sizeof (buffer),
+                                       g_value_get_float (value)));
+    case G_TYPE_DOUBLE:
+      return g_strdup (g_ascii_dtostr (buffer, sizeof (buffer),
+                                       g_value_get_double (value)));
+    default:
+      break;
+    }
+
+  if (g_value_fits_pointer (value) && g_value_peek_pointer (value) == NULL)
+    return g_strdup ("NULL");
+
+  if (!g_type_is_a (G_VALUE_TYPE (value), G_TYPE_OBJECT))
+    return NULL;
+
+  object = g_value_peek_pointer (value);
+
+  for (i = 0; i < objects->len; i++)
+    {
+      if (g_ptr_array_index (objects, i) == object)
+        break;
+    }
+
+  if (i == objects->len)
+    g_ptr_array_add (objects, object);
+
+  return g_strdup_printf ("%s %p", G_OBJECT_TYPE_NAME (object), object);
+}
+
+/* Identifies the extensions created with the same parameters, or returns
+ * %NULL if one of them can't be compared */
+static gchar *
+shared_extension_fingerprint (PeasPluginInfo *info,
+                              GType           extension_type,
+                              guint           n_parameters,
+                              GParameter     *parameters,
+                              GPtrArray      *objects)
+{
+  GString *fingerprint;
+  gchar **values;
+  guint i;
+
+  values = g_new0 (gchar *, n_parameters + 1);
+
+  for (i = 0; i < n_parameters; i++)
+    {
+      gchar *contents = value_fingerprint (&parameters[i].value, objects);
+
+      if (contents == NULL)
+        {
+          g_strfreev (values);
+          return NULL;
+        }
+
+      values[i] = g_strconcat (parameters[i].name, "=", contents, NULL);
+      g_free (contents);
+    }
+
+  /* The order of the parameters does not matter */
+  qsort (values, n_parameters, sizeof (gchar *), compare_strings);
+
+  fingerprint = g_string_new (info->module_name);
+  g_string_append_printf (fingerprint, "\n%s", g_type_name (extension_type));
+
+  for (i = 0; i < n_parameters; i++)
+    g_string_append_printf (fingerprint, "\n%s", values[i]);
+
+  g_strfreev (values);
+
+  return g_string_free (fingerprint, FALSE);
+}
+
+/**
+ * peas_engine_get_shared_extensionv:
+ * @engine: A #PeasEngine.
+ * @info: A loaded #PeasPluginInfo.
+ * @extension_type: The implemented extension #GType.
+ * @n_parameters: the length of the @parameters array.
+ * @parameters: an array of #GParameter.
+ *
+ * Like peas_engine_create_extensionv(), but returns the same extension
+ * as long as it is alive when it is asked for the same @info,
+ * @extension_type and parameters. Objects are compared by identity, and
+ * numbers, booleans, enumerations, flags, strings and string arrays by
+ * content. With other pointers or boxed values, a new extension is
+ * returned every time.
+ *
+ * The extension is only shared until it is destroyed, one of the objects
+ * passed as parameters is finalized or its plugin is unloaded, so that
+ * the extension is created again once it is reloaded.
+ *
+ * Returns: (transfer full): a new reference to a #PeasExtension wrapping
+ * the @extension_type instance, or %NULL.
+ */
+PeasExtension *
+peas_engine_get_shared_extensionv (PeasEngine     *engine,
+                                   PeasPluginInfo *info,
+                                   GType           extension_type,
+                                   guint           n_parameters,
+                                   GParameter     *parameters)
+{
+  gchar *fingerprint;
+  GPtrArray *objects;
+  SharedExtension *shared;
+  PeasExtension *exten;
+  guint i;
+
+  g_return_val_if_fail (PEAS_IS_ENGINE (engine), NULL);
+  g_return_val_if_fail (info != NULL, NULL);
+
+  objects = g_ptr_array_new ();
+  fingerprint = shared_extension_fingerprint (info, extension_type,
+                                              n_parameters, parameters,
+                                              objects);
+
+  /* Other pointers are not watched, their address could be reused by
+   * another value which would then get the extension made for this one */
+  if (fingerprint == NULL)
+    {
+      g_ptr_array_free (objects, TRUE);
+      return peas_engine_create_extensionv (engine, info, extension_type,
+                                            n_parameters, parameters);
+    }
+
+  shared = g_hash_table_lookup (engine->priv->shared_extensions, fingerprint);
+  if (shared != NULL)
+    {
+      g_ptr_array_free (objects, TRUE);
+      g_free (fingerprint);
+      return g_object_ref (shared->exten);
+    }
+
+  exten = peas_engine_create_extensionv (engine, info, extension_type,
+                                         n_parameters, parameters);
+  if (exten == NULL)
+    {
+      g_ptr_array_free (objects, TRUE);
+      g_free (fingerprint);
+      return NULL;
+    }
+
+  shared = g_slice_new (SharedExtension);
+  shared->engine = engine;
+  shared->info = info;
+  shared->fingerprint = fingerprint;
+  shared->exten = exten;
+  shared->objects = objects;
+
+  g_hash_table_insert (engine->priv->shared_extensions, fingerprint, shared);
+  g_object_weak_ref (G_OBJECT (exten),
+                     (GWeakNotify) shared_extension_finalized, shared);
+
+  for (i = 0; i < objects->len; i++)
+    g_object_weak_ref (g_ptr_array_index (objects, i),
+                       (GWeakNotify) shared_extension_finalized, shared);
+
+  return exten;
 }
 
 /**
@@ -1002,6 +1982,10 @@ peas_engine_create_extension_valist (PeasEngine     *engine,
  * principle of never giving you the actual object (also because it might as
  * well *not* be an actual object).
  *
+ * If @info declares its extension types, the plugin is actually loaded by
+ * its loader the first time an extension of one of those types is created.
+ * See peas_plugin_info_get_extension_types().
+ *
  * Returns: (transfer full): a new instance of #PeasExtension wrapping
  * the @extension_type instance, or %NULL.
  */
@@ -1066,19 +2050,271 @@ peas_engine_get_loaded_plugins (PeasEngine *engine)
     }
 }
 
-static gboolean
-string_in_strv (const gchar  *needle,
-                const gchar **haystack)
+static void
+add_plugin_to_target (PeasEngine     *engine,
+                      GHashTable     *target,
+                      PeasPluginInfo *info)
 {
   guint i;
 
-  if (haystack == NULL)
-    return FALSE;
+  if (g_hash_table_lookup (target, info) != NULL)
+    return;
 
-  for (i = 0; haystack[i] != NULL; i++)
-    if (strcmp (haystack[i], needle) == 0)
-      return TRUE;
-  return FALSE;
+  g_hash_table_insert (target, info, info);
+
+  for (i = 0; info->dependencies[i] != NULL; i++)
+    {
+      PeasPluginInfo *dep_info;
+
+      dep_info = g_hash_table_lookup (engine->priv->plugin_names,
+                                      info->dependencies[i]);
+
+      if (dep_info != NULL)
+        add_plugin_to_target (engine, target, dep_info);
+    }
+}
+
+/* The plugins to load, grouped in wavefronts: the plugins of a wavefront
+ * only depend on plugins of the previous ones, so they can be prefetched
+ * concurrently, and are activated in wavefront order. */
+typedef struct {
+  GPtrArray *infos;
+  GPtrArray *loaders;
+  GArray *wavefronts;
+} LoadSchedule;
+
+typedef struct {
+  LoadSchedule *schedule;
+  GMutex *lock;
+  GCond *cond;
+  guint n_pending;
+} PrefetchWavefront;
+
+#define PREFETCH_MAX_THREADS 4
+
+static gint
+compare_wavefronts (gconstpointer a,
+                    gconstpointer b,
+                    gpointer      user_data)
+{
+  GHashTable *wavefronts = (GHashTable *) user_data;
+  guint wavefront_a, wavefront_b;
+
+  /* The elements are pointers to the infos */
+  wavefront_a = GPOINTER_TO_UINT (g_hash_table_lookup (wavefronts,
+                                                       *(gconstpointer *) a));
+  wavefront_b = GPOINTER_TO_UINT (g_hash_table_lookup (wavefronts,
+                                                       *(gconstpointer *) b));
+
+  return wavefront_a < wavefront_b ? -1 : (wavefront_a > wavefront_b ? 1 : 0);
+}
+
+/* Schedules the plugins of @target which are not loaded yet. */
+static LoadSchedule *
+load_schedule_new (PeasEngine *engine,
+                   GHashTable *target)
+{
+  LoadSchedule *schedule;
+  GHashTable *wavefronts;
+  GPtrArray *order;
+  guint i, j;
+
+  schedule = g_slice_new (LoadSchedule);
+  schedule->infos = g_ptr_array_new ();
+  schedule->loaders = g_ptr_array_new ();
+  schedule->wavefronts = g_array_new (FALSE, FALSE, sizeof (guint));
+
+  /* Maps the plugins to load to their wavefront, plus one */
+  wavefronts = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+  order = get_topological_order (engine);
+
+  for (i = 0; i < order->len; i++)
+    {
+      PeasPluginInfo *info = (PeasPluginInfo *) g_ptr_array_index (order, i);
+      guint wavefront = 1;
+
+      if (g_hash_table_lookup (target, info) == NULL ||
+          peas_plugin_info_is_loaded (info) ||
+          !peas_plugin_info_is_available (info))
+        continue;
+
+      /* The dependencies come first in the topological order */
+      for (j = 0; info->dependencies[j] != NULL; j++)
+        {
+          PeasPluginInfo *dep_info;
+          guint dep_wavefront;
+
+          dep_info = g_hash_table_lookup (engine->priv->plugin_names,
+                                          info->dependencies[j]);
+          if (dep_info == NULL || dep_info == info)
+            continue;
+
+          dep_wavefront = GPOINTER_TO_UINT (g_hash_table_lookup (wavefronts,
+                                                                 dep_info));
+          wavefront = MAX (wavefront, dep_wavefront + 1);
+        }
+
+      g_hash_table_insert (wavefronts, info, GUINT_TO_POINTER (wavefront));
+      g_ptr_array_add (schedule->infos, _peas_plugin_info_ref (info));
+    }
+
+  /* This sort is stable, so the dependency order is kept */
+  g_qsort_with_data (schedule->infos->pdata, schedule->infos->len,
+                     sizeof (gpointer), compare_wavefronts, wavefronts);
+
+  for (i = 0; i < schedule->infos->len; i++)
+    {
+      PeasPluginInfo *info = g_ptr_array_index (schedule->infos, i);
+      PeasPluginLoader *loader;
+      guint wavefront;
+
+      /* Loaders are loaded on this thread, and the plugins whose loading
+       * is deferred until an extension is requested are not prefetched */
+      if (info->extension_types != NULL)
+        loader = NULL;
+      else
+        loader = get_plugin_loader (engine, info);
+      g_ptr_array_add (schedule->loaders,
+                       loader != NULL ? g_object_ref (loader) : NULL);
+
+      wavefront = GPOINTER_TO_UINT (g_hash_table_lookup (wavefronts, info)) - 1;
+      g_array_append_val (schedule->wavefronts, wavefront);
+    }
+
+  g_hash_table_destroy (wavefronts);
+
+  return schedule;
+}
+
+static void
+load_schedule_free (LoadSchedule *schedule)
+{
+  guint i;
+
+  for (i = 0; i < schedule->infos->len; i++)
+    {
+      _peas_plugin_info_unref (g_ptr_array_index (schedule->infos, i));
+
+      if (g_ptr_array_index (schedule->loaders, i) != NULL)
+        g_object_unref (g_ptr_array_index (schedule->loaders, i));
+    }
+
+  g_ptr_array_free (schedule->infos, TRUE);
+  g_ptr_array_free (schedule->loaders, TRUE);
+  g_array_free (schedule->wavefronts, TRUE);
+
+  g_slice_free (LoadSchedule, schedule);
+}
+
+static void
+prefetch_scheduled_plugin (LoadSchedule *schedule,
+                           guint         index)
+{
+  PeasPluginLoader *loader = g_ptr_array_index (schedule->loaders, index);
+
+  if (loader != NULL)
+    peas_plugin_loader_prefetch (loader,
+                                 g_ptr_array_index (schedule->infos, index));
+}
+
+/* Releases what was prefetched for the scheduled plugins
+ * which did not get loaded, whatever the reason. */
+static void
+load_schedule_release (LoadSchedule *schedule)
+{
+  guint i;
+
+  for (i = 0; i < schedule->infos->len; i++)
+    {
+      PeasPluginInfo *info = g_ptr_array_index (schedule->infos, i);
+      PeasPluginLoader *loader = g_ptr_array_index (schedule->loaders, i);
+
+      if (loader != NULL && !peas_plugin_info_is_loaded (info))
+        peas_plugin_loader_release_prefetch (loader, info);
+    }
+}
+
+static void
+prefetch_wavefront_job (gpointer           index_plus_one,
+                        PrefetchWavefront *wavefront)
+{
+  prefetch_scheduled_plugin (wavefront->schedule,
+                             GPOINTER_TO_UINT (index_plus_one) - 1);
+
+  g_mutex_lock (wavefront->lock);
+  if (--wavefront->n_pending == 0)
+    g_cond_signal (wavefront->cond);
+  g_mutex_unlock (wavefront->lock);
+}
+
+/* Prefetches the scheduled plugins one wavefront after the other, the
+ * plugins of a wavefront being prefetched concurrently. This blocks.
+ * Without the thread system, the plugins are prefetched one by one. */
+static void
+load_schedule_prefetch (LoadSchedule *schedule,
+                        GCancellable *cancellable)
+{
+  PrefetchWavefront wavefront;
+  GThreadPool *pool;
+  guint start, end, i;
+
+  if (!g_thread_supported ())
+    {
+      for (i = 0; i < schedule->infos->len; i++)
+        {
+          if (g_cancellable_is_cancelled (cancellable))
+            break;
+
+          prefetch_scheduled_plugin (schedule, i);
+        }
+
+      return;
+    }
+
+  wavefront.schedule = schedule;
+  wavefront.lock = g_mutex_new ();
+  wavefront.cond = g_cond_new ();
+  wavefront.n_pending = 0;
+
+  pool = g_thread_pool_new ((GFunc) prefetch_wavefront_job, &wavefront,
+                            PREFETCH_MAX_THREADS, FALSE, NULL);
+
+  for (start = 0; start < schedule->infos->len; start = end)
+    {
+      guint current = g_array_index (schedule->wavefronts, guint, start);
+
+      for (end = start + 1; end < schedule->infos->len; end++)
+        {
+          if (g_array_index (schedule->wavefronts, guint, end) != current)
+            break;
+        }
+
+      if (g_cancellable_is_cancelled (cancellable))
+        break;
+
+      if (end - start == 1)
+        {
+          prefetch_scheduled_plugin (schedule, start);
+          continue;
+        }
+
+      g_mutex_lock (wavefront.lock);
+      wavefront.n_pending = end - start;
+      g_mutex_unlock (wavefront.lock);
+
+      for (i = start; i < end; i++)
+        g_thread_pool_push (pool, GUINT_TO_POINTER (i + 1), NULL);
+
+      g_mutex_lock (wavefront.lock);
+      while (wavefront.n_pending > 0)
+        g_cond_wait (wavefront.cond, wavefront.lock);
+      g_mutex_unlock (wavefront.lock);
+    }
+
+  g_thread_pool_free (pool, FALSE, TRUE);
+  g_cond_free (wavefront.cond);
+  g_mutex_free (wavefront.lock);
 }
 
 /**
@@ -1088,34 +2324,347 @@ string_in_strv (const gchar  *needle,
  *
  * Sets the list of loaded plugins for @engine. When this function is called,
  * the #PeasEngine will load all the plugins whose names are in @plugin_names,
- * and ensures all other active plugins are unloaded.
+ * along with their dependencies, and ensures all other active plugins are
+ * unloaded.
+ *
+ * The plugins are unloaded before their dependencies, and loaded after them,
+ * all within a single transaction. If the #PeasEngine:prefetch-plugins
+ * property is set, the plugins to load are prefetched concurrently first.
  */
 void
 peas_engine_set_loaded_plugins (PeasEngine   *engine,
                                 const gchar **plugin_names)
 {
-  GList *pl;
+  GHashTable *target;
+  GPtrArray *order;
+  LoadSchedule *schedule = NULL;
+  guint i;
 
-  for (pl = engine->priv->plugin_list; pl; pl = pl->next)
+  g_return_if_fail (PEAS_IS_ENGINE (engine));
+
+  /* The requested plugins and their dependencies */
+  target = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+  for (i = 0; plugin_names != NULL && plugin_names[i] != NULL; i++)
     {
-      PeasPluginInfo *info = (PeasPluginInfo *) pl->data;
-      const gchar *module_name;
-      gboolean is_loaded;
-      gboolean to_load;
+      PeasPluginInfo *info;
 
-      if (!peas_plugin_info_is_available (info))
-        continue;
+      info = g_hash_table_lookup (engine->priv->plugin_names, plugin_names[i]);
 
-      module_name = peas_plugin_info_get_module_name (info);
-      is_loaded = peas_plugin_info_is_loaded (info);
+      if (info != NULL)
+        add_plugin_to_target (engine, target, info);
+    }
 
-      to_load = string_in_strv (module_name, plugin_names);
+  order = get_topological_order (engine);
 
-      if (!is_loaded && to_load)
-        g_signal_emit (engine, signals[LOAD_PLUGIN], 0, info);
-      else if (is_loaded && !to_load)
+  /* Prefetching starts a pool of threads, so it is opt-in */
+  if (engine->priv->prefetch_plugins && g_thread_supported ())
+    {
+      schedule = load_schedule_new (engine, target);
+      load_schedule_prefetch (schedule, NULL);
+    }
+
+  peas_engine_begin_transaction (engine);
+
+  /* Unload the dependent plugins first */
+  for (i = order->len; i > 0; i--)
+    {
+      PeasPluginInfo *info = (PeasPluginInfo *) g_ptr_array_index (order, i - 1);
+
+      if (peas_plugin_info_is_loaded (info) &&
+          g_hash_table_lookup (target, info) == NULL)
         g_signal_emit (engine, signals[UNLOAD_PLUGIN], 0, info);
     }
+
+  /* Then load the dependencies first */
+  for (i = 0; i < order->len; i++)
+    {
+      PeasPluginInfo *info = (PeasPluginInfo *) g_ptr_array_index (order, i);
+
+      if (peas_plugin_info_is_available (info) &&
+          !peas_plugin_info_is_loaded (info) &&
+          g_hash_table_lookup (target, info) != NULL)
+        g_signal_emit (engine, signals[LOAD_PLUGIN], 0, info);
+    }
+
+  peas_engine_commit_transaction (engine);
+
+  if (schedule != NULL)
+    {
+      load_schedule_release (schedule);
+      load_schedule_free (schedule);
+    }
+
+  g_hash_table_destroy (target);
+}
+
+typedef struct {
+  PeasEngine *engine;
+  GCancellable *cancellable;
+  GSimpleAsyncResult *result;
+  LoadSchedule *schedule;
+
+  /* A requested plugin which is not scheduled as it is unavailable */
+  PeasPluginInfo *unavailable;
+} AsyncLoadData;
+
+static void
+async_load_data_free (AsyncLoadData *data)
+{
+  load_schedule_free (data->schedule);
+
+  if (data->unavailable != NULL)
+    _peas_plugin_info_unref (data->unavailable);
+
+  if (data->cancellable != NULL)
+    g_object_unref (data->cancellable);
+
+  g_object_unref (data->result);
+  g_object_unref (data->engine);
+
+  g_slice_free (AsyncLoadData, data);
+}
+
+static void
+prefetch_plugins_thread (GSimpleAsyncResult *result,
+                         GObject            *object,
+                         GCancellable       *cancellable)
+{
+  AsyncLoadData *data;
+
+  data = (AsyncLoadData *) g_simple_async_result_get_op_res_gpointer (result);
+
+  load_schedule_prefetch (data->schedule, cancellable);
+}
+
+/* Called in the main context of the caller, once the plugins were
+ * prefetched in a thread. */
+static void
+prefetch_plugins_done (GObject      *object,
+                       GAsyncResult *prefetch_result,
+                       gpointer      user_data)
+{
+  AsyncLoadData *data = (AsyncLoadData *) user_data;
+  PeasPluginInfo *failed = data->unavailable;
+  GError *error = NULL;
+  guint i;
+
+  if (g_cancellable_set_error_if_cancelled (data->cancellable, &error))
+    {
+      g_simple_async_result_set_from_error (data->result, error);
+      g_error_free (error);
+      goto out;
+    }
+
+  peas_engine_begin_transaction (data->engine);
+
+  for (i = 0; i < data->schedule->infos->len; i++)
+    {
+      PeasPluginInfo *info = g_ptr_array_index (data->schedule->infos, i);
+
+      if (!peas_engine_load_plugin (data->engine, info) && failed == NULL)
+        failed = info;
+    }
+
+  peas_engine_commit_transaction (data->engine);
+
+  if (failed != NULL)
+    g_simple_async_result_set_error (data->result,
+                                     PEAS_ENGINE_ERROR,
+                                     PEAS_ENGINE_ERROR_LOADING_FAILED,
+                                     "Could not load plugin '%s'",
+                                     peas_plugin_info_get_module_name (failed));
+  else
+    g_simple_async_result_set_op_res_gboolean (data->result, TRUE);
+
+out:
+  load_schedule_release (data->schedule);
+
+  g_simple_async_result_complete (data->result);
+  async_load_data_free (data);
+}
+
+static void
+load_plugins_async (PeasEngine          *engine,
+                    const GList         *infos,
+                    GCancellable        *cancellable,
+                    GAsyncReadyCallback  callback,
+                    gpointer             user_data,
+                    gpointer             source_tag)
+{
+  AsyncLoadData *data;
+  GSimpleAsyncResult *prefetch_result;
+  GHashTable *target;
+  const GList *item;
+
+  /* The requested plugins and their dependencies */
+  target = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+  data = g_slice_new0 (AsyncLoadData);
+
+  for (item = infos; item != NULL; item = item->next)
+    {
+      PeasPluginInfo *info = (PeasPluginInfo *) item->data;
+
+      /* It fails as peas_engine_load_plugin() would */
+      if (!peas_plugin_info_is_available (info))
+        {
+          if (data->unavailable == NULL)
+            data->unavailable = _peas_plugin_info_ref (info);
+          continue;
+        }
+
+      add_plugin_to_target (engine, target, info);
+    }
+
+  data->engine = g_object_ref (engine);
+  data->cancellable = cancellable != NULL ? g_object_ref (cancellable) : NULL;
+  data->result = g_simple_async_result_new (G_OBJECT (engine), callback,
+                                            user_data, source_tag);
+  data->schedule = load_schedule_new (engine, target);
+
+  g_hash_table_destroy (target);
+
+  prefetch_result = g_simple_async_result_new (G_OBJECT (engine),
+                                               prefetch_plugins_done,
+                                               data,
+                                               load_plugins_async);
+  g_simple_async_result_set_op_res_gpointer (prefetch_result, data, NULL);
+  g_simple_async_result_run_in_thread (prefetch_result,
+                                       prefetch_plugins_thread,
+                                       G_PRIORITY_DEFAULT,
+                                       cancellable);
+  g_object_unref (prefetch_result);
+}
+
+/**
+ * peas_engine_load_plugins_async:
+ * @engine: A #PeasEngine.
+ * @infos: (element-type Peas.PluginInfo): A list of #PeasPluginInfo.
+ * @cancellable: (allow-none): A #GCancellable, or %NULL.
+ * @callback: A #GAsyncReadyCallback to call when the plugins are loaded.
+ * @user_data: The data to pass to @callback.
+ *
+ * Asynchronously loads the plugins in @infos along with their dependencies.
+ *
+ * The blocking parts of loading the plugins, like opening the shared
+ * libraries, are done in threads when the plugin loaders support it: the
+ * plugins which do not depend on each other are handled concurrently, one
+ * wave of dependencies after the other. The plugins are then loaded in the
+ * thread-default main context of the caller, in a single transaction (see
+ * peas_engine_begin_transaction()), so the "load-plugin" signal is emitted
+ * there as usual.
+ *
+ * When the plugins are loaded, @callback will be called. You can then call
+ * peas_engine_load_plugins_finish() to get the result of the operation.
+ */
+void
+peas_engine_load_plugins_async (PeasEngine          *engine,
+                                const GList         *infos,
+                                GCancellable        *cancellable,
+                                GAsyncReadyCallback  callback,
+                                gpointer             user_data)
+{
+  g_return_if_fail (PEAS_IS_ENGINE (engine));
+  g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+  load_plugins_async (engine, infos, cancellable, callback, user_data,
+                      peas_engine_load_plugins_async);
+}
+
+/**
+ * peas_engine_load_plugins_finish:
+ * @engine: A #PeasEngine.
+ * @result: A #GAsyncResult.
+ * @error: A location to store the error, or %NULL.
+ *
+ * Finishes an operation started with peas_engine_load_plugins_async().
+ *
+ * If the operation was cancelled before the plugins were loaded, none of
+ * them is loaded and %G_IO_ERROR_CANCELLED is returned. Otherwise, the
+ * plugins which could be loaded stay loaded even if others failed.
+ *
+ * Returns: %TRUE if all the plugins were loaded, %FALSE if @error is set.
+ */
+gboolean
+peas_engine_load_plugins_finish (PeasEngine    *engine,
+                                 GAsyncResult  *result,
+                                 GError       **error)
+{
+  GSimpleAsyncResult *simple = (GSimpleAsyncResult *) result;
+
+  g_return_val_if_fail (PEAS_IS_ENGINE (engine), FALSE);
+  g_return_val_if_fail (g_simple_async_result_is_valid (result,
+                                                        G_OBJECT (engine),
+                                                        peas_engine_load_plugins_async),
+                        FALSE);
+
+  if (g_simple_async_result_propagate_error (simple, error))
+    return FALSE;
+
+  return g_simple_async_result_get_op_res_gboolean (simple);
+}
+
+/**
+ * peas_engine_load_plugin_async:
+ * @engine: A #PeasEngine.
+ * @info: A #PeasPluginInfo.
+ * @cancellable: (allow-none): A #GCancellable, or %NULL.
+ * @callback: A #GAsyncReadyCallback to call when the plugin is loaded.
+ * @user_data: The data to pass to @callback.
+ *
+ * Asynchronously loads the plugin corresponding to @info, see
+ * peas_engine_load_plugins_async().
+ *
+ * When the plugin is loaded, @callback will be called. You can then call
+ * peas_engine_load_plugin_finish() to get the result of the operation.
+ */
+void
+peas_engine_load_plugin_async (PeasEngine          *engine,
+                               PeasPluginInfo      *info,
+                               GCancellable        *cancellable,
+                               GAsyncReadyCallback  callback,
+                               gpointer             user_data)
+{
+  GList infos = { NULL, NULL, NULL };
+
+  g_return_if_fail (PEAS_IS_ENGINE (engine));
+  g_return_if_fail (info != NULL);
+  g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+  infos.data = info;
+
+  load_plugins_async (engine, &infos, cancellable, callback, user_data,
+                      peas_engine_load_plugin_async);
+}
+
+/**
+ * peas_engine_load_plugin_finish:
+ * @engine: A #PeasEngine.
+ * @result: A #GAsyncResult.
+ * @error: A location to store the error, or %NULL.
+ *
+ * Finishes an operation started with peas_engine_load_plugin_async().
+ *
+ * Returns: %TRUE if the plugin was loaded, %FALSE if @error is set.
+ */
+gboolean
+peas_engine_load_plugin_finish (PeasEngine    *engine,
+                                GAsyncResult  *result,
+                                GError       **error)
+{
+  GSimpleAsyncResult *simple = (GSimpleAsyncResult *) result;
+
+  g_return_val_if_fail (PEAS_IS_ENGINE (engine), FALSE);
+  g_return_val_if_fail (g_simple_async_result_is_valid (result,
+                                                        G_OBJECT (engine),
+                                                        peas_engine_load_plugin_async),
+                        FALSE);
+
+  if (g_simple_async_result_propagate_error (simple, error))
+    return FALSE;
+
+  return g_simple_async_result_get_op_res_gboolean (simple);
 }
 
 /**
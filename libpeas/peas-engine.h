@@ -23,6 +23,7 @@
 #define __PEAS_ENGINE_H__
 
 #include <glib.h>
+#include <gio/gio.h>
 #include "peas-plugin-info.h"
 #include "peas-extension.h"
 
@@ -41,6 +42,24 @@ G_BEGIN_DECLS
  * Engine at the heart of the Peas plugin system.
  */
 typedef struct _PeasEngine         PeasEngine;
+/**
+ * PEAS_ENGINE_ERROR:
+ *
+ * Error domain for #PeasEngine. Errors in this domain will be from the
+ * #PeasEngineError enumeration.
+ */
+#define PEAS_ENGINE_ERROR (peas_engine_error_quark ())
+
+/**
+ * PeasEngineError:
+ * @PEAS_ENGINE_ERROR_LOADING_FAILED: A plugin could not be loaded.
+ *
+ * Error codes returned by #PeasEngine functions.
+ */
+typedef enum {
+  PEAS_ENGINE_ERROR_LOADING_FAILED
+} PeasEngineError;
+
 typedef struct _PeasEngineClass    PeasEngineClass;
 typedef struct _PeasEnginePrivate  PeasEnginePrivate;
 
@@ -68,6 +87,7 @@ struct _PeasEngineClass {
 };
 
 GType             peas_engine_get_type            (void) G_GNUC_CONST;
+GQuark            peas_engine_error_quark         (void);
 PeasEngine       *peas_engine_get_default         (void);
 
 void              peas_engine_add_search_path     (PeasEngine      *engine,
@@ -84,14 +104,39 @@ void              peas_engine_set_loaded_plugins  (PeasEngine      *engine,
                                                    const gchar    **plugin_names);
 PeasPluginInfo   *peas_engine_get_plugin_info     (PeasEngine      *engine,
                                                    const gchar     *plugin_name);
+const GList      *peas_engine_get_plugins_for_extension_type
+                                                  (PeasEngine      *engine,
+                                                   GType            extension_type);
+const GList      *peas_engine_get_dependents      (PeasEngine      *engine,
+                                                   PeasPluginInfo  *info);
 
 /* plugin loading and unloading */
 gboolean          peas_engine_load_plugin         (PeasEngine      *engine,
                                                    PeasPluginInfo  *info);
 gboolean          peas_engine_unload_plugin       (PeasEngine      *engine,
                                                    PeasPluginInfo  *info);
+
+void              peas_engine_load_plugin_async   (PeasEngine      *engine,
+                                                   PeasPluginInfo  *info,
+                                                   GCancellable    *cancellable,
+                                                   GAsyncReadyCallback callback,
+                                                   gpointer         user_data);
+gboolean          peas_engine_load_plugin_finish  (PeasEngine      *engine,
+                                                   GAsyncResult    *result,
+                                                   GError         **error);
+void              peas_engine_load_plugins_async  (PeasEngine      *engine,
+                                                   const GList     *infos,
+                                                   GCancellable    *cancellable,
+                                                   GAsyncReadyCallback callback,
+                                                   gpointer         user_data);
+gboolean          peas_engine_load_plugins_finish (PeasEngine      *engine,
+                                                   GAsyncResult    *result,
+                                                   GError         **error);
 void              peas_engine_garbage_collect     (PeasEngine      *engine);
 
+void              peas_engine_begin_transaction   (PeasEngine      *engine);
+void              peas_engine_commit_transaction  (PeasEngine      *engine);
+
 gboolean          peas_engine_provides_extension  (PeasEngine      *engine,
                                                    PeasPluginInfo  *info,
                                                    GType            extension_type);
@@ -102,6 +147,12 @@ PeasExtension    *peas_engine_create_extensionv   (PeasEngine      *engine,
                                                    GType            extension_type,
                                                    guint            n_parameters,
                                                    GParameter      *parameters);
+PeasExtension    *peas_engine_get_shared_extensionv
+                                                  (PeasEngine      *engine,
+                                                   PeasPluginInfo  *info,
+                                                   GType            extension_type,
+                                                   guint            n_parameters,
+                                                   GParameter      *parameters);
 PeasExtension    *peas_engine_create_extension_valist
                                                   (PeasEngine      *engine,
                                                    PeasPluginInfo  *info,
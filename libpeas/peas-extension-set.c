@@ -26,10 +26,11 @@
 #include <string.h>
 
 #include "peas-extension-set.h"
-#include "peas-plugin-info.h"
+#include "peas-plugin-info-priv.h"
 #include "peas-marshal.h"
 #include "peas-helpers.h"
 #include "peas-introspection.h"
+#include "peas-method-priv.h"
 
 /**
  * SECTION:peas-extension-set
@@ -95,17 +96,69 @@
  *   return set;
  * }
  * ]|
+ *
+ * A set created with peas_extension_set_new_lazy() only records which
+ * loaded plugins provide the extension type, and creates their extensions
+ * the first time they are needed, that is when the set is called or
+ * iterated, or when peas_extension_set_get_extension() is used.
+ * #PeasExtensionSet::extension-added is emitted when an extension is
+ * actually created, and #PeasExtensionSet::extension-removed only for
+ * extensions that were created.
+ *
+ * The sets created with peas_extension_set_new_shared() for the same
+ * extension type and construct properties share their extension instances
+ * instead of each creating their own, see
+ * peas_engine_get_shared_extensionv().
+ *
+ * The extensions of a set are called and iterated in a defined order.
+ * Extensions of plugins with a higher priority, see
+ * peas_plugin_info_get_priority(), come first, and extensions of equal
+ * priority are kept in the order their plugins were loaded. This can be
+ * changed with peas_extension_set_set_sort_func().
  **/
 
 G_DEFINE_TYPE (PeasExtensionSet, peas_extension_set, G_TYPE_OBJECT);
 
+typedef struct {
+  gchar *key;
+  gchar *value;
+  PeasExtensionSetFilterFunc func;
+  gpointer data;
+  GDestroyNotify destroy;
+} PeasExtensionSetFilter;
+
 struct _PeasExtensionSetPrivate {
   PeasEngine *engine;
   GType exten_type;
   guint n_parameters;
   GParameter *parameters;
-
-  GList *extensions;
+  gboolean lazy;
+  gboolean shared;
+  PeasExtensionSetFilter filter;
+
+  /* The extensions sorted by compare_items(), indexed by their
+   * PeasPluginInfo. Removing an extension leaves a hole in the array,
+   * which is only compacted once holes make up half of it. */
+  GPtrArray *extensions;
+  GHashTable *extension_index;
+  guint n_holes;
+  guint foreach_depth;
+  guint next_serial;
+  /* Extensions were appended while iterating */
+  gboolean needs_sort;
+
+  PeasExtensionSetCompareFunc sort_func;
+  gpointer sort_data;
+  GDestroyNotify sort_destroy;
+
+  /* Held back for extensions-added and extensions-removed, the
+   * PeasPluginInfos and the PeasExtensions in two parallel arrays */
+  GPtrArray *added_infos;
+  GPtrArray *added_extensions;
+  GPtrArray *removed_infos;
+  GPtrArray *removed_extensions;
+  guint flush_id;
+  gulong commit_handler_id;
 
   gulong load_handler_id;
   gulong unload_handler_id;
@@ -113,7 +166,18 @@ struct _PeasExtensionSetPrivate {
 
 typedef struct {
   PeasPluginInfo *info;
+  /* NULL until needed for lazy sets */
   PeasExtension *exten;
+  guint index;
+  /* The order in which the extensions were added, for a stable sort */
+  guint serial;
+
+  /* The extension of a lazy set could not be created */
+  guint failed : 1;
+
+  /* Removed while iterating with peas_extension_set_foreach(),
+   * the item is freed once the iteration is over */
+  guint removed : 1;
 } ExtensionItem;
 
 typedef struct {
@@ -121,10 +185,45 @@ typedef struct {
   GParameter *parameters;
 } PeasParameterArray;
 
+/* How the constructors set the "lazy" and "shared" properties */
+typedef enum {
+  SET_LAZY   = 1 << 0,
+  SET_SHARED = 1 << 1
+} SetFlags;
+
+/* A call of peas_extension_set_call_parallel() */
+typedef struct {
+  PeasMethod *method;
+  GIArgument *args;
+  GMutex *lock;
+  GCond *cond;
+  guint n_pending;
+} ParallelCall;
+
+typedef struct {
+  ParallelCall *call;
+  PeasPluginInfo *info;
+  PeasExtension *exten;
+  GIArgument return_value;
+  gboolean success;
+  gboolean thread_safe;
+} ParallelCallItem;
+
+#define CALL_MAX_THREADS 4
+
+/* Shared by all the sets, created on the first parallel call */
+G_LOCK_DEFINE_STATIC (call_pool);
+static GThreadPool *call_pool = NULL;
+
+/* Set on the threads of the pool, whose jobs must not wait for it */
+static GStaticPrivate in_call_pool = G_STATIC_PRIVATE_INIT;
+
 /* Signals */
 enum {
   EXTENSION_ADDED,
   EXTENSION_REMOVED,
+  EXTENSIONS_ADDED,
+  EXTENSIONS_REMOVED,
   LAST_SIGNAL
 };
 
@@ -135,7 +234,10 @@ enum {
   PROP_0,
   PROP_ENGINE,
   PROP_EXTENSION_TYPE,
-  PROP_CONSTRUCT_PROPERTIES
+  PROP_CONSTRUCT_PROPERTIES,
+  PROP_LAZY,
+  PROP_SHARED,
+  PROP_FILTER
 };
 
 static void
@@ -155,6 +257,61 @@ set_construct_properties (PeasExtensionSet *set,
     }
 }
 
+static void
+set_filter (PeasExtensionSet       *set,
+            PeasExtensionSetFilter *filter)
+{
+  if (filter == NULL)
+    return;
+
+  set->priv->filter.key = g_strdup (filter->key);
+  set->priv->filter.value = g_strdup (filter->value);
+  set->priv->filter.func = filter->func;
+  set->priv->filter.data = filter->data;
+  set->priv->filter.destroy = filter->destroy;
+}
+
+/* Whether the value of @key in the plugin file of @info is @value,
+ * or whether @key is present at all when @value is %NULL */
+static gboolean
+matches_key (PeasPluginInfo *info,
+             const gchar    *key,
+             const gchar    *value)
+{
+  const GValue *key_value = NULL;
+
+  if (info->keys != NULL)
+    key_value = g_hash_table_lookup (info->keys, key);
+
+  if (key_value == NULL)
+    return FALSE;
+
+  if (value == NULL)
+    return TRUE;
+
+  if (G_VALUE_HOLDS_BOOLEAN (key_value))
+    {
+      if (g_value_get_boolean (key_value))
+        return g_str_equal (value, "true") || g_str_equal (value, "1");
+      else
+        return g_str_equal (value, "false") || g_str_equal (value, "0");
+    }
+
+  return g_strcmp0 (g_value_get_string (key_value), value) == 0;
+}
+
+static gboolean
+matches_filter (PeasExtensionSet *set,
+                PeasPluginInfo   *info)
+{
+  PeasExtensionSetFilter *filter = &set->priv->filter;
+
+  if (filter->key != NULL && !matches_key (info, filter->key, filter->value))
+    return FALSE;
+
+  return filter->func == NULL || filter->func (info, filter->data);
+}
+
 static void
 peas_extension_set_set_property (GObject      *object,
                                  guint         prop_id,
@@ -175,6 +332,15 @@ peas_extension_set_set_property (GObject      *object,
     case PROP_CONSTRUCT_PROPERTIES:
       set_construct_properties (set, g_value_get_pointer (value));
       break;
+    case PROP_LAZY:
+      set->priv->lazy = g_value_get_boolean (value);
+      break;
+    case PROP_SHARED:
+      set->priv->shared = g_value_get_boolean (value);
+      break;
+    case PROP_FILTER:
+      set_filter (set, g_value_get_pointer (value));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
     }
@@ -196,74 +362,445 @@ peas_extension_set_get_property (GObject    *object,
     case PROP_EXTENSION_TYPE:
       g_value_set_gtype (value, set->priv->exten_type);
       break;
+    case PROP_LAZY:
+      g_value_set_boolean (value, set->priv->lazy);
+      break;
+    case PROP_SHARED:
+      g_value_set_boolean (value, set->priv->shared);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
     }
 }
 
+static PeasExtension *
+create_extension (PeasExtensionSet *set,
+                  PeasPluginInfo   *info)
+{
+  if (set->priv->shared)
+    return peas_engine_get_shared_extensionv (set->priv->engine, info,
+                                              set->priv->exten_type,
+                                              set->priv->n_parameters,
+                                              set->priv->parameters);
+
+  return peas_engine_create_extensionv (set->priv->engine, info,
+                                        set->priv->exten_type,
+                                        set->priv->n_parameters,
+                                        set->priv->parameters);
+}
+
+static void
+flush_batched (PeasExtensionSet *set)
+{
+  GPtrArray *infos, *extensions;
+
+  if (set->priv->flush_id != 0)
+    {
+      g_source_remove (set->priv->flush_id);
+      set->priv->flush_id = 0;
+    }
+
+  g_object_ref (set);
+
+  /* Handlers may load or unload plugins, which queues new batches */
+  if (set->priv->removed_infos != NULL)
+    {
+      infos = set->priv->removed_infos;
+      extensions = set->priv->removed_extensions;
+      set->priv->removed_infos = set->priv->removed_extensions = NULL;
+
+      if (infos->len > 0)
+        g_signal_emit (set, signals[EXTENSIONS_REMOVED], 0, infos, extensions);
+
+      g_ptr_array_free (infos, TRUE);
+      g_ptr_array_free (extensions, TRUE);
+    }
+
+  if (set->priv->added_infos != NULL)
+    {
+      infos = set->priv->added_infos;
+      extensions = set->priv->added_extensions;
+      set->priv->added_infos = set->priv->added_extensions = NULL;
+
+      if (infos->len > 0)
+        g_signal_emit (set, signals[EXTENSIONS_ADDED], 0, infos, extensions);
+
+      g_ptr_array_free (infos, TRUE);
+      g_ptr_array_free (extensions, TRUE);
+    }
+
+  g_object_unref (set);
+}
+
+static gboolean
+flush_batched_idle (PeasExtensionSet *set)
+{
+  set->priv->flush_id = 0;
+  flush_batched (set);
+
+  return FALSE;
+}
+
+static void
+loaded_plugins_changed_cb (PeasEngine       *engine,
+                           GList            *plugins,
+                           PeasExtensionSet *set)
+{
+  flush_batched (set);
+}
+
+/* The batches are flushed once the engine's transaction is committed, or
+ * from the main loop for the changes happening outside of a transaction,
+ * like the creation of the extensions of a lazy set. */
+static void
+queue_batched (PeasExtensionSet *set,
+               GPtrArray       **infos,
+               GPtrArray       **extensions,
+               PeasPluginInfo   *info,
+               PeasExtension    *exten)
+{
+  if (*infos == NULL)
+    {
+      *infos = g_ptr_array_new ();
+      *extensions = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+    }
+
+  g_ptr_array_add (*infos, info);
+  g_ptr_array_add (*extensions, g_object_ref (exten));
+
+  if (set->priv->flush_id == 0)
+    set->priv->flush_id = g_idle_add ((GSourceFunc) flush_batched_idle, set);
+}
+
+static void
+emit_extension_added (PeasExtensionSet *set,
+                      PeasPluginInfo   *info,
+                      PeasExtension    *exten)
+{
+  g_signal_emit (set, signals[EXTENSION_ADDED], 0, info, exten);
+
+  if (g_signal_has_handler_pending (set, signals[EXTENSIONS_ADDED], 0, FALSE))
+    queue_batched (set, &set->priv->added_infos, &set->priv->added_extensions,
+                   info, exten);
+}
+
+/* Creates the extension of a lazy set's item on first use */
+static PeasExtension *
+ensure_extension (PeasExtensionSet *set,
+                  ExtensionItem    *item)
+{
+  if (item->exten != NULL || item->failed)
+    return item->exten;
+
+  item->exten = create_extension (set, item->info);
+
+  if (item->exten == NULL)
+    item->failed = TRUE;
+  else
+    emit_extension_added (set, item->info, item->exten);
+
+  return item->exten;
+}
+
+static void
+free_extension_item (ExtensionItem *item)
+{
+/*  peas_plugin_info_unref (item->info); */
+  if (item->exten != NULL)
+    g_object_unref (item->exten);
+
+  g_slice_free (ExtensionItem, item);
+}
+
+static void
+emit_extension_removed (PeasExtensionSet *set,
+                        ExtensionItem    *item)
+{
+  GPtrArray *added = set->priv->added_extensions;
+  guint i;
+
+  if (item->exten == NULL)
+    return;
+
+  g_signal_emit (set, signals[EXTENSION_REMOVED], 0, item->info, item->exten);
+
+  /* An extension added and removed within a batch is not reported at all */
+  for (i = 0; added != NULL && i < added->len; i++)
+    {
+      if (g_ptr_array_index (added, i) == item->exten)
+        {
+          g_ptr_array_remove_index (set->priv->added_infos, i);
+          g_ptr_array_remove_index (added, i);
+          return;
+        }
+    }
+
+  if (g_signal_has_handler_pending (set, signals[EXTENSIONS_REMOVED], 0, FALSE))
+    queue_batched (set, &set->priv->removed_infos,
+                   &set->priv->removed_extensions, item->info, item->exten);
+}
+
+static void
+remove_extension_item (PeasExtensionSet *set,
+                       ExtensionItem    *item)
+{
+  emit_extension_removed (set, item);
+  free_extension_item (item);
+}
+
+/* Drops the holes of the array, keeping the order of the extensions */
+static void
+compact_extensions (PeasExtensionSet *set)
+{
+  GPtrArray *extensions = set->priv->extensions;
+  guint i, j;
+
+  for (i = 0, j = 0; i < extensions->len; i++)
+    {
+      ExtensionItem *item = g_ptr_array_index (extensions, i);
+
+      if (item == NULL)
+        continue;
+
+      item->index = j;
+      g_ptr_array_index (extensions, j++) = item;
+    }
+
+  g_ptr_array_set_size (extensions, j);
+  set->priv->n_holes = 0;
+}
+
+static gint
+compare_items (PeasExtensionSet    *set,
+               const ExtensionItem *a,
+               const ExtensionItem *b)
+{
+  if (set->priv->sort_func != NULL)
+    {
+      gint cmp = set->priv->sort_func (a->info, b->info, set->priv->sort_data);
+
+      if (cmp != 0)
+        return cmp;
+    }
+  else
+    {
+      gint priority_a = peas_plugin_info_get_priority (a->info);
+      gint priority_b = peas_plugin_info_get_priority (b->info);
+
+      /* Higher priorities first */
+      if (priority_a != priority_b)
+        return priority_a > priority_b ? -1 : 1;
+    }
+
+  return a->serial < b->serial ? -1 : (a->serial > b->serial ? 1 : 0);
+}
+
+static gint
+compare_items_with_data (gconstpointer a,
+                         gconstpointer b,
+                         gpointer      user_data)
+{
+  return compare_items ((PeasExtensionSet *) user_data,
+                        *((const ExtensionItem **) a),
+                        *((const ExtensionItem **) b));
+}
+
+static void
+sort_extensions (PeasExtensionSet *set)
+{
+  guint i;
+
+  compact_extensions (set);
+
+  g_ptr_array_sort_with_data (set->priv->extensions,
+                              compare_items_with_data, set);
+
+  for (i = 0; i < set->priv->extensions->len; i++)
+    {
+      ExtensionItem *item = g_ptr_array_index (set->priv->extensions, i);
+
+      item->index = i;
+    }
+
+  set->priv->needs_sort = FALSE;
+}
+
+static void
+insert_extension_item (PeasExtensionSet *set,
+                       ExtensionItem    *item)
+{
+  GPtrArray *extensions = set->priv->extensions;
+  guint low, high, i;
+
+  /* Iterations rely on the indexes, so the new extension
+   * is only moved in place once they are over */
+  if (set->priv->foreach_depth > 0)
+    {
+      item->index = extensions->len;
+      g_ptr_array_add (extensions, item);
+      set->priv->needs_sort = TRUE;
+      return;
+    }
+
+  if (set->priv->n_holes > 0)
+    compact_extensions (set);
+
+  /* Find the first extension coming after the new one */
+  low = 0;
+  high = extensions->len;
+  while (low < high)
+    {
+      guint mid = low + (high - low) / 2;
+
+      if (compare_items (set, g_ptr_array_index (extensions, mid), item) <= 0)
+        low = mid + 1;
+      else
+        high = mid;
+    }
+
+  g_ptr_array_add (extensions, NULL);
+  memmove (&extensions->pdata[low + 1], &extensions->pdata[low],
+           (extensions->len - low - 1) * sizeof (gpointer));
+  extensions->pdata[low] = item;
+
+  for (i = low; i < extensions->len; i++)
+    ((ExtensionItem *) g_ptr_array_index (extensions, i))->index = i;
+}
+
 static void
 add_extension (PeasExtensionSet *set,
                PeasPluginInfo   *info)
 {
-  PeasExtension *exten;
+  PeasExtension *exten = NULL;
   ExtensionItem *item;
 
   /* Let's just ignore unloaded plugins... */
   if (!peas_plugin_info_is_loaded (info))
     return;
 
-  exten = peas_engine_create_extensionv (set->priv->engine, info,
-                                         set->priv->exten_type,
-                                         set->priv->n_parameters,
-                                         set->priv->parameters);
-  if (!exten)
+  /* ...and the ones filtered out, before creating anything */
+  if (!matches_filter (set, info))
     return;
 
+  if (set->priv->lazy)
+    {
+      if (!peas_engine_provides_extension (set->priv->engine, info,
+                                           set->priv->exten_type))
+        return;
+    }
+  else
+    {
+      exten = create_extension (set, info);
+      if (!exten)
+        return;
+    }
+
 /*  peas_plugin_info_ref (info); */
 
-  item = (ExtensionItem *) g_slice_new (ExtensionItem);
+  item = (ExtensionItem *) g_slice_new0 (ExtensionItem);
   item->info = info;
   item->exten = exten;
+  item->serial = set->priv->next_serial++;
 
-  set->priv->extensions = g_list_prepend (set->priv->extensions, item);
-  g_signal_emit (set, signals[EXTENSION_ADDED], 0, info, exten);
+  insert_extension_item (set, item);
+  g_hash_table_insert (set->priv->extension_index, info, item);
+
+  if (exten != NULL)
+    emit_extension_added (set, info, exten);
 }
 
 static void
-remove_extension_item (PeasExtensionSet *set,
-                       ExtensionItem    *item)
+free_extension_slot (PeasExtensionSet *set,
+                     ExtensionItem    *item)
 {
-  g_signal_emit (set, signals[EXTENSION_REMOVED], 0, item->info, item->exten);
-
-/*  peas_plugin_info_unref (item->info); */
-  g_object_unref (item->exten);
+  g_ptr_array_index (set->priv->extensions, item->index) = NULL;
+  free_extension_item (item);
 
-  g_slice_free (ExtensionItem, item);
+  if (++set->priv->n_holes > set->priv->extensions->len / 2)
+    compact_extensions (set);
 }
 
 static void
 remove_extension (PeasExtensionSet *set,
                   PeasPluginInfo   *info)
 {
-  GList *l;
   ExtensionItem *item;
 
-  for (l = set->priv->extensions; l; l = l->next)
+  item = g_hash_table_lookup (set->priv->extension_index, info);
+  if (item == NULL)
+    return;
+
+  g_hash_table_remove (set->priv->extension_index, info);
+
+  /* A foreach callback may still be using the extension, and the
+   * array must not be compacted during the iteration, so only flag
+   * it for now. */
+  if (set->priv->foreach_depth > 0)
     {
-      item = (ExtensionItem *) l->data;
-      if (item->info != info)
+      item->removed = TRUE;
+      emit_extension_removed (set, item);
+      return;
+    }
+
+  emit_extension_removed (set, item);
+  free_extension_slot (set, item);
+}
+
+static void
+free_removed_items (PeasExtensionSet *set)
+{
+  guint i;
+
+  for (i = 0; i < set->priv->extensions->len; i++)
+    {
+      ExtensionItem *item = g_ptr_array_index (set->priv->extensions, i);
+
+      if (item == NULL || !item->removed)
         continue;
 
-      remove_extension_item (set, item);
-      set->priv->extensions = g_list_delete_link (set->priv->extensions, l);
-      return;
+      g_ptr_array_index (set->priv->extensions, i) = NULL;
+      free_extension_item (item);
+      set->priv->n_holes++;
+    }
+
+  if (set->priv->n_holes > set->priv->extensions->len / 2)
+    compact_extensions (set);
+}
+
+/* While iterating, removed extensions are only flagged and the array is
+ * never compacted, so indexes stay valid. Extensions appended during the
+ * iteration are past @len and are not visited. The set is kept alive as
+ * the callbacks may drop the last reference to it. */
+static void
+begin_iteration (PeasExtensionSet *set,
+                 guint            *len)
+{
+  g_object_ref (set);
+  set->priv->foreach_depth++;
+  *len = set->priv->extensions->len;
+}
+
+static void
+end_iteration (PeasExtensionSet *set)
+{
+  if (--set->priv->foreach_depth == 0)
+    {
+      free_removed_items (set);
+
+      if (set->priv->needs_sort)
+        sort_extensions (set);
     }
+
+  g_object_unref (set);
 }
 
 static void
 peas_extension_set_init (PeasExtensionSet *set)
 {
   set->priv = G_TYPE_INSTANCE_GET_PRIVATE (set, PEAS_TYPE_EXTENSION_SET, PeasExtensionSetPrivate);
+
+  set->priv->extensions = g_ptr_array_new ();
+  set->priv->extension_index = g_hash_table_new (g_direct_hash, g_direct_equal);
 }
 
 static void
@@ -285,13 +822,16 @@ peas_extension_set_constructed (GObject *object)
           g_signal_connect_data (set->priv->engine, "unload-plugin",
                                  G_CALLBACK (remove_extension), set,
                                  NULL, G_CONNECT_SWAPPED);
+  set->priv->commit_handler_id =
+          g_signal_connect (set->priv->engine, "loaded-plugins-changed",
+                            G_CALLBACK (loaded_plugins_changed_cb), set);
 }
 
 static void
 peas_extension_set_dispose (GObject *object)
 {
   PeasExtensionSet *set = PEAS_EXTENSION_SET (object);
-  GList *l;
+  guint i;
 
   if (set->priv->load_handler_id != 0)
     {
@@ -305,12 +845,66 @@ peas_extension_set_dispose (GObject *object)
       set->priv->unload_handler_id = 0;
     }
 
-  for (l = set->priv->extensions; l;)
+  if (set->priv->commit_handler_id != 0)
+    {
+      g_signal_handler_disconnect (set->priv->engine, set->priv->commit_handler_id);
+      set->priv->commit_handler_id = 0;
+    }
+
+  for (i = 0; i < set->priv->extensions->len; i++)
+    {
+      ExtensionItem *item = g_ptr_array_index (set->priv->extensions, i);
+
+      if (item == NULL)
+        continue;
+
+      g_ptr_array_index (set->priv->extensions, i) = NULL;
+
+      if (item->removed)
+        free_extension_item (item);
+      else
+        remove_extension_item (set, item);
+    }
+
+  g_ptr_array_set_size (set->priv->extensions, 0);
+  g_hash_table_remove_all (set->priv->extension_index);
+  set->priv->n_holes = 0;
+
+  /* The pending batches are dropped with the set */
+  if (set->priv->flush_id != 0)
+    {
+      g_source_remove (set->priv->flush_id);
+      set->priv->flush_id = 0;
+    }
+
+  if (set->priv->added_infos != NULL)
+    {
+      g_ptr_array_free (set->priv->added_infos, TRUE);
+      g_ptr_array_free (set->priv->added_extensions, TRUE);
+      set->priv->added_infos = set->priv->added_extensions = NULL;
+    }
+
+  if (set->priv->removed_infos != NULL)
     {
-      remove_extension_item (set, (ExtensionItem *) l->data);
-      l = g_list_delete_link (l, l);
+      g_ptr_array_free (set->priv->removed_infos, TRUE);
+      g_ptr_array_free (set->priv->removed_extensions, TRUE);
+      set->priv->removed_infos = set->priv->removed_extensions = NULL;
     }
 
+  if (set->priv->sort_destroy != NULL)
+    set->priv->sort_destroy (set->priv->sort_data);
+
+  set->priv->sort_func = NULL;
+  set->priv->sort_data = NULL;
+  set->priv->sort_destroy = NULL;
+
+  if (set->priv->filter.destroy != NULL)
+    set->priv->filter.destroy (set->priv->filter.data);
+
+  set->priv->filter.func = NULL;
+  set->priv->filter.data = NULL;
+  set->priv->filter.destroy = NULL;
+
   if (set->priv->parameters != NULL)
     {
       while (set->priv->n_parameters-- > 0)
@@ -325,6 +919,22 @@ peas_extension_set_dispose (GObject *object)
       g_object_unref (set->priv->engine);
       set->priv->engine = NULL;
     }
+
+  G_OBJECT_CLASS (peas_extension_set_parent_class)->dispose (object);
+}
+
+static void
+peas_extension_set_finalize (GObject *object)
+{
+  PeasExtensionSet *set = PEAS_EXTENSION_SET (object);
+
+  g_ptr_array_free (set->priv->extensions, TRUE);
+  g_hash_table_destroy (set->priv->extension_index);
+
+  g_free (set->priv->filter.key);
+  g_free (set->priv->filter.value);
+
+  G_OBJECT_CLASS (peas_extension_set_parent_class)->finalize (object);
 }
 
 static gboolean
@@ -333,15 +943,23 @@ peas_extension_set_call_real (PeasExtensionSet *set,
                               GIArgument       *args)
 {
   gboolean ret = TRUE;
-  GList *l;
+  guint i, len;
   GIArgument dummy;
 
-  for (l = set->priv->extensions; l; l = l->next)
+  begin_iteration (set, &len);
+
+  for (i = 0; i < len; i++)
     {
-      ExtensionItem *item = (ExtensionItem *) l->data;
+      ExtensionItem *item = g_ptr_array_index (set->priv->extensions, i);
+
+      if (item == NULL || item->removed || !ensure_extension (set, item))
+        continue;
+
       ret = peas_extension_callv (item->exten, method_name, args, &dummy) && ret;
     }
 
+  end_iteration (set);
+
   return ret;
 }
 
@@ -355,6 +973,7 @@ peas_extension_set_class_init (PeasExtensionSetClass *klass)
   object_class->get_property = peas_extension_set_get_property;
   object_class->constructed = peas_extension_set_constructed;
   object_class->dispose = peas_extension_set_dispose;
+  object_class->finalize = peas_extension_set_finalize;
 
   klass->call = peas_extension_set_call_real;
 
@@ -412,10 +1031,66 @@ peas_extension_set_class_init (PeasExtensionSetClass *klass)
                   PEAS_TYPE_PLUGIN_INFO | G_SIGNAL_TYPE_STATIC_SCOPE,
                   PEAS_TYPE_EXTENSION);
 
-  g_object_class_install_property (object_class, PROP_ENGINE,
-                                   g_param_spec_object ("engine",
-                                                        "Engine",
-                                                        "The PeasEngine this set is attached to",
+  /**
+   * PeasExtensionSet::extensions-added:
+   * @set: A #PeasExtensionSet.
+   * @infos: (element-type Peas.PluginInfo): the #PeasPluginInfo<!-- -->s
+   *   of the plugins providing @extensions.
+   * @extensions: (element-type Peas.Extension): the added
+   *   #PeasExtension<!-- -->s.
+   *
+   * The extensions-added signal is the batched form of
+   * #PeasExtensionSet::extension-added. It is emitted once the outermost
+   * transaction of the engine is committed, see
+   * peas_engine_begin_transaction(), or from the main loop for extensions
+   * added outside of a transaction, with all the extensions added since the
+   * last emission. An extension which was removed in the meantime is left
+   * out.
+   *
+   * Only the extensions added while a handler is connected are reported.
+   * The arrays are only valid during the emission.
+   */
+  signals[EXTENSIONS_ADDED] =
+    g_signal_new ("extensions-added",
+                  the_type,
+                  G_SIGNAL_RUN_LAST,
+                  G_STRUCT_OFFSET (PeasExtensionSetClass, extensions_added),
+                  NULL, NULL,
+                  peas_cclosure_marshal_VOID__BOXED_BOXED,
+                  G_TYPE_NONE,
+                  2,
+                  G_TYPE_PTR_ARRAY | G_SIGNAL_TYPE_STATIC_SCOPE,
+                  G_TYPE_PTR_ARRAY | G_SIGNAL_TYPE_STATIC_SCOPE);
+
+  /**
+   * PeasExtensionSet::extensions-removed:
+   * @set: A #PeasExtensionSet.
+   * @infos: (element-type Peas.PluginInfo): the #PeasPluginInfo<!-- -->s
+   *   of the plugins which provided @extensions.
+   * @extensions: (element-type Peas.Extension): the removed
+   *   #PeasExtension<!-- -->s.
+   *
+   * The extensions-removed signal is the batched form of
+   * #PeasExtensionSet::extension-removed, emitted like
+   * #PeasExtensionSet::extensions-added and before it. The extensions
+   * are kept alive until the end of the emission.
+   */
+  signals[EXTENSIONS_REMOVED] =
+    g_signal_new ("extensions-removed",
+                  the_type,
+                  G_SIGNAL_RUN_LAST,
+                  G_STRUCT_OFFSET (PeasExtensionSetClass, extensions_removed),
+                  NULL, NULL,
+                  peas_cclosure_marshal_VOID__BOXED_BOXED,
+                  G_TYPE_NONE,
+                  2,
+                  G_TYPE_PTR_ARRAY | G_SIGNAL_TYPE_STATIC_SCOPE,
+                  G_TYPE_PTR_ARRAY | G_SIGNAL_TYPE_STATIC_SCOPE);
+
+  g_object_class_install_property (object_class, PROP_ENGINE,
+                                   g_param_spec_object ("engine",
+                                                        "Engine",
+                                                        "The PeasEngine this set is attached to",
                                                         PEAS_TYPE_ENGINE,
                                                         G_PARAM_READWRITE |
                                                         G_PARAM_CONSTRUCT_ONLY |
@@ -438,6 +1113,45 @@ peas_extension_set_class_init (PeasExtensionSetClass *klass)
                                                          G_PARAM_CONSTRUCT_ONLY |
                                                          G_PARAM_STATIC_STRINGS));
 
+  /**
+   * PeasExtensionSet:lazy:
+   *
+   * Whether the extensions are only created the first time they are
+   * needed, see peas_extension_set_new_lazy().
+   */
+  g_object_class_install_property (object_class, PROP_LAZY,
+                                   g_param_spec_boolean ("lazy",
+                                                         "Lazy",
+                                                         "Whether the extensions are created on first use",
+                                                         FALSE,
+                                                         G_PARAM_READWRITE |
+                                                         G_PARAM_CONSTRUCT_ONLY |
+                                                         G_PARAM_STATIC_STRINGS));
+
+  /**
+   * PeasExtensionSet:shared:
+   *
+   * Whether the extensions are shared with the other sets created with
+   * the same extension type and construct properties, see
+   * peas_extension_set_new_shared().
+   */
+  g_object_class_install_property (object_class, PROP_SHARED,
+                                   g_param_spec_boolean ("shared",
+                                                         "Shared",
+                                                         "Whether the extensions are shared with other sets",
+                                                         FALSE,
+                                                         G_PARAM_READWRITE |
+                                                         G_PARAM_CONSTRUCT_ONLY |
+                                                         G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (object_class, PROP_FILTER,
+                                   g_param_spec_pointer ("filter",
+                                                         "Filter",
+                                                         "The plugins to create extensions for",
+                                                         G_PARAM_WRITABLE |
+                                                         G_PARAM_CONSTRUCT_ONLY |
+                                                         G_PARAM_STATIC_STRINGS));
+
   g_type_class_add_private (klass, sizeof (PeasExtensionSetPrivate));
 }
 
@@ -455,20 +1169,314 @@ PeasExtension *
 peas_extension_set_get_extension (PeasExtensionSet *set,
                                   PeasPluginInfo   *info)
 {
-  GList *l;
+  ExtensionItem *item;
 
   g_return_val_if_fail (PEAS_IS_EXTENSION_SET (set), NULL);
   g_return_val_if_fail (info != NULL, NULL);
 
-  for (l = set->priv->extensions; l != NULL; l = l->next)
+  /* Removed items are not indexed */
+  item = g_hash_table_lookup (set->priv->extension_index, info);
+
+  return item != NULL ? ensure_extension (set, item) : NULL;
+}
+
+/**
+ * peas_extension_set_foreach:
+ * @set: A #PeasExtensionSet.
+ * @func: A function to call for each extension.
+ * @data: Optional data to pass to the function.
+ *
+ * Calls @func for each #PeasExtension contained in @set, so that the
+ * methods of the extensions can be called directly.
+ *
+ * Plugins may be loaded or unloaded by @func. Extensions removed from @set
+ * during the iteration are skipped, but stay alive until the iteration is
+ * over. Extensions added during the iteration are not visited.
+ */
+void
+peas_extension_set_foreach (PeasExtensionSet            *set,
+                            PeasExtensionSetForeachFunc  func,
+                            gpointer                     data)
+{
+  guint i, len;
+
+  g_return_if_fail (PEAS_IS_EXTENSION_SET (set));
+  g_return_if_fail (func != NULL);
+
+  begin_iteration (set, &len);
+
+  for (i = 0; i < len; i++)
+    {
+      ExtensionItem *item = g_ptr_array_index (set->priv->extensions, i);
+
+      if (item != NULL && !item->removed && ensure_extension (set, item))
+        func (set, item->info, item->exten, data);
+    }
+
+  end_iteration (set);
+}
+
+/**
+ * peas_extension_set_set_sort_func:
+ * @set: A #PeasExtensionSet.
+ * @func: (allow-none): The function comparing extensions, or %NULL to
+ *   sort them by priority.
+ * @data: Optional data to pass to @func.
+ * @destroy: (allow-none): Function to free @data.
+ *
+ * Sets the order in which the extensions of @set are called and iterated.
+ * Extensions which @func considers equal are kept in the order their
+ * plugins were loaded.
+ *
+ * By default, the extensions of plugins with a higher priority come first,
+ * see peas_plugin_info_get_priority().
+ */
+void
+peas_extension_set_set_sort_func (PeasExtensionSet            *set,
+                                  PeasExtensionSetCompareFunc  func,
+                                  gpointer                     data,
+                                  GDestroyNotify               destroy)
+{
+  g_return_if_fail (PEAS_IS_EXTENSION_SET (set));
+
+  if (set->priv->sort_destroy != NULL)
+    set->priv->sort_destroy (set->priv->sort_data);
+
+  set->priv->sort_func = func;
+  set->priv->sort_data = data;
+  set->priv->sort_destroy = destroy;
+
+  if (set->priv->foreach_depth > 0)
+    set->priv->needs_sort = TRUE;
+  else
+    sort_extensions (set);
+}
+
+/**
+ * peas_extension_set_error_quark:
+ *
+ * Returns: the #GQuark of the #PEAS_EXTENSION_SET_ERROR error domain.
+ */
+GQuark
+peas_extension_set_error_quark (void)
+{
+  return g_quark_from_static_string ("peas-extension-set-error");
+}
+
+static void
+parallel_call_item_run (ParallelCallItem *item)
+{
+  item->success = peas_extension_call_methodv (item->exten,
+                                               item->call->method,
+                                               item->call->args,
+                                               &item->return_value);
+}
+
+static void
+parallel_call_job (ParallelCallItem *item,
+                   gpointer          user_data)
+{
+  ParallelCall *call = item->call;
+
+  g_static_private_set (&in_call_pool, GINT_TO_POINTER (TRUE), NULL);
+
+  parallel_call_item_run (item);
+
+  g_mutex_lock (call->lock);
+  if (--call->n_pending == 0)
+    g_cond_signal (call->cond);
+  g_mutex_unlock (call->lock);
+}
+
+static GThreadPool *
+get_call_pool (void)
+{
+  GThreadPool *pool;
+
+  G_LOCK (call_pool);
+
+  if (call_pool == NULL)
+    call_pool = g_thread_pool_new ((GFunc) parallel_call_job, NULL,
+                                   CALL_MAX_THREADS, FALSE, NULL);
+  pool = call_pool;
+
+  G_UNLOCK (call_pool);
+
+  return pool;
+}
+
+/* The other loaders need to hold the lock of their interpreter,
+ * so their extensions are always called from the calling thread. */
+static gboolean
+is_thread_safe (PeasPluginInfo *info)
+{
+  return info->thread_safe && g_ascii_strcasecmp (info->loader, "C") == 0;
+}
+
+/**
+ * peas_extension_set_call_parallel:
+ * @set: A #PeasExtensionSet.
+ * @method: A #PeasMethod of the extension type of @set.
+ * @args: the arguments for the method.
+ * @func: (allow-none): A function to call with the result of each extension.
+ * @data: Optional data to pass to @func.
+ * @error: Return location for a #GError, or %NULL.
+ *
+ * Call @method on all the #PeasExtension instances contained in @set,
+ * concurrently when possible, and waits for all the calls to be over.
+ *
+ * The extensions of the plugins declaring themselves thread-safe through
+ * the "ThreadSafe" key of their plugin info file are called from a bounded
+ * pool of threads, see peas_plugin_info_is_thread_safe(). The others are
+ * called one after the other from the calling thread, which must be the
+ * one they are used from, usually the main thread.
+ *
+ * The pool is only used once the application called g_thread_init().
+ * When called from an extension which already runs on the pool, all the
+ * extensions are called from the calling thread, as the pool could be
+ * waiting for that extension to return.
+ *
+ * As @args are shared by all the calls, @method must not have out
+ * arguments. Its return values are passed to @func from the calling
+ * thread once all the calls are over, in the order of the set.
+ *
+ * The plugins of a set created with peas_extension_set_new_lazy() which
+ * turn out not to provide an extension count as failed calls.
+ *
+ * Return value: %TRUE if all the calls succeeded. Otherwise @error is set
+ * to a %PEAS_EXTENSION_SET_ERROR_CALL_FAILED error naming the failing
+ * plugins.
+ */
+gboolean
+peas_extension_set_call_parallel (PeasExtensionSet           *set,
+                                  PeasMethod                 *method,
+                                  GIArgument                 *args,
+                                  PeasExtensionSetResultFunc  func,
+                                  gpointer                    data,
+                                  GError                    **error)
+{
+  ParallelCall call;
+  ParallelCallItem *items;
+  GThreadPool *pool = NULL;
+  GString *failed = NULL;
+  guint n_items = 0, n_thread_safe = 0, i, len;
+
+  g_return_val_if_fail (PEAS_IS_EXTENSION_SET (set), FALSE);
+  g_return_val_if_fail (method != NULL, FALSE);
+  g_return_val_if_fail (method->plan->iface_type == set->priv->exten_type,
+                        FALSE);
+  g_return_val_if_fail (method->plan->n_out_args == 0, FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  call.method = method;
+  call.args = args;
+
+  /* Creating the extensions of a lazy set emits signals */
+  begin_iteration (set, &len);
+
+  items = g_new0 (ParallelCallItem, len);
+
+  /* The extensions are kept alive even if a call unloads their plugin */
+  for (i = 0; i < len; i++)
+    {
+      ExtensionItem *item = g_ptr_array_index (set->priv->extensions, i);
+
+      if (item == NULL || item->removed)
+        continue;
+
+      items[n_items].call = &call;
+      items[n_items].info = item->info;
+
+      /* Only a lazy set can find out this late that there is none */
+      if (ensure_extension (set, item) == NULL)
+        {
+          n_items++;
+          continue;
+        }
+
+      items[n_items].exten = g_object_ref (item->exten);
+      items[n_items].thread_safe = is_thread_safe (item->info);
+
+      if (items[n_items].thread_safe)
+        n_thread_safe++;
+
+      n_items++;
+    }
+
+  end_iteration (set);
+
+  /* A single thread-safe extension is not worth a thread switch */
+  if (n_thread_safe > 1 && g_thread_supported () &&
+      g_static_private_get (&in_call_pool) == NULL)
+    pool = get_call_pool ();
+
+  if (pool != NULL)
+    {
+      call.lock = g_mutex_new ();
+      call.cond = g_cond_new ();
+      call.n_pending = n_thread_safe;
+
+      for (i = 0; i < n_items; i++)
+        {
+          if (items[i].thread_safe)
+            g_thread_pool_push (pool, &items[i], NULL);
+        }
+    }
+
+  for (i = 0; i < n_items; i++)
+    {
+      if (items[i].exten == NULL)
+        continue;
+
+      if (pool == NULL || !items[i].thread_safe)
+        parallel_call_item_run (&items[i]);
+    }
+
+  if (pool != NULL)
     {
-      ExtensionItem *item = l->data;
+      g_mutex_lock (call.lock);
+      while (call.n_pending > 0)
+        g_cond_wait (call.cond, call.lock);
+      g_mutex_unlock (call.lock);
 
-      if (item->info == info)
-        return item->exten;
+      g_cond_free (call.cond);
+      g_mutex_free (call.lock);
     }
 
-  return NULL;
+  for (i = 0; i < n_items; i++)
+    {
+      if (!items[i].success)
+        {
+          if (failed == NULL)
+            failed = g_string_new (NULL);
+          else
+            g_string_append (failed, ", ");
+
+          g_string_append (failed,
+                           peas_plugin_info_get_module_name (items[i].info));
+        }
+      else if (func != NULL)
+        {
+          func (set, items[i].info, items[i].exten, &items[i].return_value,
+                data);
+        }
+
+      if (items[i].exten != NULL)
+        g_object_unref (items[i].exten);
+    }
+
+  g_free (items);
+
+  if (failed == NULL)
+    return TRUE;
+
+  g_set_error (error, PEAS_EXTENSION_SET_ERROR,
+               PEAS_EXTENSION_SET_ERROR_CALL_FAILED,
+               "Calling '%s' failed for: %s",
+               peas_method_get_name (method), failed->str);
+  g_string_free (failed, TRUE);
+
+  return FALSE;
 }
 
 /**
@@ -515,23 +1523,17 @@ peas_extension_set_call_valist (PeasExtensionSet *set,
                                 const gchar      *method_name,
                                 va_list           va_args)
 {
-  GICallableInfo *callable_info;
+  const PeasCallPlan *plan;
   GIArgument *args;
-  gint n_args;
 
   g_return_val_if_fail (PEAS_IS_EXTENSION_SET (set), FALSE);
   g_return_val_if_fail (method_name != NULL, FALSE);
 
-  callable_info = peas_gi_get_method_info (set->priv->exten_type, method_name);
-  g_return_val_if_fail (callable_info != NULL, FALSE);
-
-  n_args = g_callable_info_get_n_args (callable_info);
-  g_return_val_if_fail (n_args >= 0, FALSE);
+  plan = peas_gi_get_call_plan (set->priv->exten_type, method_name);
+  g_return_val_if_fail (plan != NULL, FALSE);
 
-  args = g_newa (GIArgument, n_args);
-  peas_gi_valist_to_arguments (callable_info, va_args, args, NULL);
-
-  g_base_info_unref ((GIBaseInfo *) callable_info);
+  args = g_newa (GIArgument, plan->n_args);
+  peas_gi_call_plan_valist_to_arguments (plan, va_args, args, NULL);
 
   return peas_extension_set_callv (set, method_name, args);
 }
@@ -562,6 +1564,357 @@ peas_extension_set_callv (PeasExtensionSet *set,
   return klass->call (set, method_name, args);
 }
 
+/**
+ * peas_extension_set_call_method:
+ * @set: A #PeasExtensionSet.
+ * @method: A #PeasMethod of the extension type of @set.
+ * @Varargs: arguments for the method.
+ *
+ * Call @method on all the #PeasExtension instances contained in @set.
+ *
+ * See peas_extension_call_method() for more information.
+ *
+ * Return value: %TRUE on successful call.
+ */
+gboolean
+peas_extension_set_call_method (PeasExtensionSet *set,
+                                PeasMethod       *method,
+                                ...)
+{
+  va_list args;
+  gboolean result;
+
+  va_start (args, method);
+  result = peas_extension_set_call_method_valist (set, method, args);
+  va_end (args);
+
+  return result;
+}
+
+/**
+ * peas_extension_set_call_method_valist:
+ * @set: A #PeasExtensionSet.
+ * @method: A #PeasMethod of the extension type of @set.
+ * @va_args: the arguments for the method.
+ *
+ * Call @method on all the #PeasExtension instances contained in @set.
+ *
+ * See peas_extension_call_method_valist() for more information.
+ *
+ * Return value: %TRUE on successful call.
+ */
+gboolean
+peas_extension_set_call_method_valist (PeasExtensionSet *set,
+                                       PeasMethod       *method,
+                                       va_list           va_args)
+{
+  GIArgument *args;
+
+  g_return_val_if_fail (PEAS_IS_EXTENSION_SET (set), FALSE);
+  g_return_val_if_fail (method != NULL, FALSE);
+
+  args = g_newa (GIArgument, method->plan->n_args);
+  peas_gi_call_plan_valist_to_arguments (method->plan, va_args, args, NULL);
+
+  return peas_extension_set_call_methodv (set, method, args);
+}
+
+/**
+ * peas_extension_set_call_methodv:
+ * @set: A #PeasExtensionSet.
+ * @method: A #PeasMethod of the extension type of @set.
+ * @args: the arguments for the method.
+ *
+ * Call @method on all the #PeasExtension instances contained in @set.
+ *
+ * See peas_extension_call_methodv() for more information.
+ *
+ * Return value: %TRUE on successful call.
+ */
+gboolean
+peas_extension_set_call_methodv (PeasExtensionSet *set,
+                                 PeasMethod       *method,
+                                 GIArgument       *args)
+{
+  gboolean ret = TRUE;
+  guint i, len;
+  GIArgument dummy;
+
+  g_return_val_if_fail (PEAS_IS_EXTENSION_SET (set), FALSE);
+  g_return_val_if_fail (method != NULL, FALSE);
+  g_return_val_if_fail (method->plan->iface_type == set->priv->exten_type,
+                        FALSE);
+
+  begin_iteration (set, &len);
+
+  for (i = 0; i < len; i++)
+    {
+      ExtensionItem *item = g_ptr_array_index (set->priv->extensions, i);
+
+      if (item == NULL || item->removed || !ensure_extension (set, item))
+        continue;
+
+      ret = peas_extension_call_methodv (item->exten, method, args, &dummy) && ret;
+    }
+
+  end_iteration (set);
+
+  return ret;
+}
+
+/* Whether @return_value, zeroed before the call, holds a value which
+ * handles the call */
+static gboolean
+is_handled (const PeasCallPlan *plan,
+            const GIArgument   *return_value)
+{
+  switch (plan->return_tag)
+    {
+    case GI_TYPE_TAG_VOID:
+      return FALSE;
+    case GI_TYPE_TAG_BOOLEAN:
+      return return_value->v_boolean;
+    case GI_TYPE_TAG_FLOAT:
+      return return_value->v_float != 0;
+    case GI_TYPE_TAG_DOUBLE:
+      return return_value->v_double != 0;
+    default:
+      return return_value->v_uint64 != 0;
+    }
+}
+
+/* The GType of the object or boxed value @plan returns, or G_TYPE_INVALID
+ * for the other types */
+static GType
+get_return_gtype (const PeasCallPlan *plan)
+{
+  GIBaseInfo *iface_info;
+  GType gtype = G_TYPE_INVALID;
+
+  if (plan->return_tag != GI_TYPE_TAG_INTERFACE || plan->return_is_enum)
+    return G_TYPE_INVALID;
+
+  iface_info = g_type_info_get_interface (plan->return_type_info);
+
+  switch (g_base_info_get_type (iface_info))
+    {
+    case GI_INFO_TYPE_OBJECT:
+    case GI_INFO_TYPE_INTERFACE:
+    case GI_INFO_TYPE_STRUCT:
+    case GI_INFO_TYPE_BOXED:
+    case GI_INFO_TYPE_UNION:
+      gtype = g_registered_type_info_get_g_type ((GIRegisteredTypeInfo *) iface_info);
+      break;
+    default:
+      break;
+    }
+
+  g_base_info_unref (iface_info);
+
+  if (G_TYPE_IS_OBJECT (gtype) || G_TYPE_IS_INTERFACE (gtype) ||
+      G_TYPE_IS_BOXED (gtype))
+    return gtype;
+
+  return G_TYPE_INVALID;
+}
+
+/* Whether the return values of @plan which the caller owns can be
+ * dropped by free_return_value() */
+static gboolean
+can_free_return_value (const PeasCallPlan *plan)
+{
+  if (g_callable_info_get_caller_owns (plan->callable_info) == GI_TRANSFER_NOTHING)
+    return TRUE;
+
+  switch (plan->return_tag)
+    {
+    case GI_TYPE_TAG_ARRAY:
+    case GI_TYPE_TAG_GLIST:
+    case GI_TYPE_TAG_GSLIST:
+    case GI_TYPE_TAG_GHASH:
+    case GI_TYPE_TAG_ERROR:
+      return FALSE;
+    case GI_TYPE_TAG_INTERFACE:
+      return plan->return_is_enum || get_return_gtype (plan) != G_TYPE_INVALID;
+    default:
+      return TRUE;
+    }
+}
+
+static void
+free_return_value (const PeasCallPlan *plan,
+                   GIArgument         *return_value)
+{
+  GType gtype;
+
+  if (g_callable_info_get_caller_owns (plan->callable_info) == GI_TRANSFER_NOTHING)
+    return;
+
+  switch (plan->return_tag)
+    {
+    case GI_TYPE_TAG_UTF8:
+    case GI_TYPE_TAG_FILENAME:
+      g_free (return_value->v_string);
+      return;
+    case GI_TYPE_TAG_INTERFACE:
+      break;
+    default:
+      return;
+    }
+
+  gtype = get_return_gtype (plan);
+  if (gtype == G_TYPE_INVALID || return_value->v_pointer == NULL)
+    return;
+
+  if (G_TYPE_IS_BOXED (gtype))
+    g_boxed_free (gtype, return_value->v_pointer);
+  else
+    g_object_unref (return_value->v_pointer);
+}
+
+/**
+ * peas_extension_set_call_method_full:
+ * @set: A #PeasExtensionSet.
+ * @method: A #PeasMethod of the extension type of @set.
+ * @mode: How the call is dispatched.
+ * @args: The arguments of the method.
+ * @return_values: (allow-none): An array of @n_return_values #GIArgument.
+ * @n_return_values: The length of @return_values.
+ *
+ * Call @method on the #PeasExtension instances contained in @set,
+ * in the order of @set, as specified by @mode.
+ *
+ * With %PEAS_EXTENSION_SET_CALL_FIRST_HANDLED, the extensions are called
+ * until one of them returns %TRUE, a non-zero number or a non-%NULL
+ * pointer, which is stored in the first element of @return_values. With
+ * %PEAS_EXTENSION_SET_CALL_COLLECT, the return value of each extension is
+ * stored in @return_values and the extensions are called until it is full,
+ * so @method must return a value. The remaining extensions are not called,
+ * nor created for a lazy set.
+ *
+ * Failed calls are skipped. The caller owns the stored return values,
+ * as described by the transfer annotation of @method. The return values
+ * which are not stored are freed, so with %PEAS_EXTENSION_SET_CALL_ALL the
+ * return values owned by the caller must be strings, objects or boxed
+ * types.
+ *
+ * Returns: the number of return values stored in @return_values.
+ */
+guint
+peas_extension_set_call_method_full (PeasExtensionSet         *set,
+                                     PeasMethod               *method,
+                                     PeasExtensionSetCallMode  mode,
+                                     GIArgument               *args,
+                                     GIArgument               *return_values,
+                                     guint                     n_return_values)
+{
+  guint n_stored = 0, i, len;
+  GIArgument return_value;
+
+  g_return_val_if_fail (PEAS_IS_EXTENSION_SET (set), 0);
+  g_return_val_if_fail (method != NULL, 0);
+  g_return_val_if_fail (method->plan->iface_type == set->priv->exten_type, 0);
+  g_return_val_if_fail (mode == PEAS_EXTENSION_SET_CALL_ALL ||
+                        (return_values != NULL && n_return_values > 0), 0);
+  g_return_val_if_fail (mode != PEAS_EXTENSION_SET_CALL_COLLECT ||
+                        method->plan->return_tag != GI_TYPE_TAG_VOID, 0);
+  g_return_val_if_fail (mode != PEAS_EXTENSION_SET_CALL_ALL ||
+                        can_free_return_value (method->plan), 0);
+
+  begin_iteration (set, &len);
+
+  for (i = 0; i < len; i++)
+    {
+      ExtensionItem *item = g_ptr_array_index (set->priv->extensions, i);
+
+      if (item == NULL || item->removed || !ensure_extension (set, item))
+        continue;
+
+      memset (&return_value, 0, sizeof (GIArgument));
+
+      if (!peas_extension_call_methodv (item->exten, method, args, &return_value))
+        continue;
+
+      if (mode == PEAS_EXTENSION_SET_CALL_ALL)
+        {
+          free_return_value (method->plan, &return_value);
+        }
+      else if (mode == PEAS_EXTENSION_SET_CALL_FIRST_HANDLED)
+        {
+          if (is_handled (method->plan, &return_value))
+            {
+              return_values[n_stored++] = return_value;
+              break;
+            }
+        }
+      else if (mode == PEAS_EXTENSION_SET_CALL_COLLECT)
+        {
+          return_values[n_stored++] = return_value;
+
+          if (n_stored == n_return_values)
+            break;
+        }
+    }
+
+  end_iteration (set);
+
+  return n_stored;
+}
+
+static PeasExtensionSet *
+extension_set_new_full (PeasEngine             *engine,
+                        GType                   exten_type,
+                        SetFlags                flags,
+                        PeasExtensionSetFilter *filter,
+                        guint                   n_parameters,
+                        GParameter             *parameters)
+{
+  PeasParameterArray construct_properties = { n_parameters, parameters };
+
+  return PEAS_EXTENSION_SET (g_object_new (PEAS_TYPE_EXTENSION_SET,
+                                           "engine", engine,
+                                           "extension-type", exten_type,
+                                           "construct-properties", &construct_properties,
+                                           "lazy", (flags & SET_LAZY) != 0,
+                                           "shared", (flags & SET_SHARED) != 0,
+                                           "filter", filter,
+                                           NULL));
+}
+
+static PeasExtensionSet *
+extension_set_new_valist_full (PeasEngine             *engine,
+                               GType                   exten_type,
+                               SetFlags                flags,
+                               PeasExtensionSetFilter *filter,
+                               const gchar            *first_property,
+                               va_list                 var_args)
+{
+  gpointer type_struct;
+  GParameter *parameters;
+  guint n_parameters;
+  PeasExtensionSet *set;
+
+  type_struct = _g_type_struct_ref (exten_type);
+
+  if (!_valist_to_parameter_list (exten_type, type_struct, first_property,
+                                  var_args, &parameters, &n_parameters))
+    {
+      /* WARNING */
+      g_return_val_if_reached (NULL);
+    }
+
+  set = extension_set_new_full (engine, exten_type, flags, filter,
+                                n_parameters, parameters);
+
+  while (n_parameters-- > 0)
+    g_value_unset (&parameters[n_parameters].value);
+  g_free (parameters);
+
+  _g_type_struct_unref (exten_type, type_struct);
+
+  return set;
+}
+
 /**
  * peas_extension_set_newv:
  * @engine: A #PeasEngine.
@@ -581,13 +1934,8 @@ peas_extension_set_newv (PeasEngine *engine,
                          guint       n_parameters,
                          GParameter *parameters)
 {
-  PeasParameterArray construct_properties = { n_parameters, parameters };
-
-  return PEAS_EXTENSION_SET (g_object_new (PEAS_TYPE_EXTENSION_SET,
-                                           "engine", engine,
-                                           "extension-type", exten_type,
-                                           "construct-properties", &construct_properties,
-                                           NULL));
+  return extension_set_new_full (engine, exten_type, 0, NULL,
+                                 n_parameters, parameters);
 }
 
 /**
@@ -610,29 +1958,8 @@ peas_extension_set_new_valist (PeasEngine  *engine,
                                const gchar *first_property,
                                va_list      var_args)
 {
-  gpointer type_struct;
-  GParameter *parameters;
-  guint n_parameters;
-  PeasExtensionSet *set;
-
-  type_struct = _g_type_struct_ref (exten_type);
-
-  if (!_valist_to_parameter_list (exten_type, type_struct, first_property,
-                                  var_args, &parameters, &n_parameters))
-    {
-      /* WARNING */
-      g_return_val_if_reached (NULL);
-    }
-
-  set = peas_extension_set_newv (engine, exten_type, n_parameters, parameters);
-
-  while (n_parameters-- > 0)
-    g_value_unset (&parameters[n_parameters].value);
-  g_free (parameters);
-
-  _g_type_struct_unref (exten_type, type_struct);
-
-  return set;
+  return extension_set_new_valist_full (engine, exten_type, 0, NULL,
+                                        first_property, var_args);
 }
 
 /**
@@ -671,3 +1998,180 @@ peas_extension_set_new (PeasEngine  *engine,
 
   return set;
 }
+
+/**
+ * peas_extension_set_new_lazyv:
+ * @engine: A #PeasEngine.
+ * @exten_type: the extension #GType.
+ * @n_parameters: the length of the @parameters array.
+ * @parameters: an array of #GParameter.
+ *
+ * Create a new lazy #PeasExtensionSet for the @exten_type extension type.
+ *
+ * See peas_extension_set_new_lazy() for more information.
+ *
+ * Returns: (transfer full): a new instance of #PeasExtensionSet.
+ */
+PeasExtensionSet *
+peas_extension_set_new_lazyv (PeasEngine *engine,
+                              GType       exten_type,
+                              guint       n_parameters,
+                              GParameter *parameters)
+{
+  return extension_set_new_full (engine, exten_type, SET_LAZY, NULL,
+                                 n_parameters, parameters);
+}
+
+/**
+ * peas_extension_set_new_lazy:
+ * @engine: A #PeasEngine.
+ * @exten_type: the extension #GType.
+ * @first_property: the name of the first property.
+ * @Varargs: the value of the first property, followed optionally by more
+ *   name/value pairs, followed by %NULL.
+ *
+ * Create a new lazy #PeasExtensionSet for the @exten_type extension type.
+ *
+ * Unlike peas_extension_set_new(), the extension of a plugin is only
+ * created the first time the set is called or iterated, or when it is
+ * requested with peas_extension_set_get_extension(). This avoids creating
+ * extensions which are never used.
+ *
+ * Returns: a new instance of #PeasExtensionSet.
+ */
+PeasExtensionSet *
+peas_extension_set_new_lazy (PeasEngine  *engine,
+                             GType        exten_type,
+                             const gchar *first_property,
+                             ...)
+{
+  va_list var_args;
+  PeasExtensionSet *set;
+
+  va_start (var_args, first_property);
+  set = extension_set_new_valist_full (engine, exten_type, SET_LAZY, NULL,
+                                       first_property, var_args);
+  va_end (var_args);
+
+  return set;
+}
+
+/**
+ * peas_extension_set_new_filtered:
+ * @engine: A #PeasEngine.
+ * @exten_type: the extension #GType.
+ * @key: (allow-none): A key of the plugin information files, or %NULL.
+ * @value: (allow-none): The value @key must have, or %NULL.
+ * @func: (allow-none): A function selecting the plugins, or %NULL.
+ * @data: Optional data to pass to @func.
+ * @destroy: (allow-none): Function to free @data.
+ * @first_property: the name of the first property.
+ * @Varargs: the value of the first property, followed optionally by more
+ *   name/value pairs, followed by %NULL.
+ *
+ * Create a new #PeasExtensionSet for the @exten_type extension type,
+ * which only contains the extensions of the plugins selected by @key,
+ * @value and @func.
+ *
+ * A plugin is selected if its information file has the extra key @key,
+ * see peas_plugin_info_get_keys(), with the value @value if it is not
+ * %NULL, and if @func returns %TRUE for it. The filter is applied before
+ * creating the extension, so nothing is created for the other plugins.
+ *
+ * See peas_extension_set_new() for more information.
+ *
+ * Returns: a new instance of #PeasExtensionSet.
+ */
+PeasExtensionSet *
+peas_extension_set_new_filtered (PeasEngine                 *engine,
+                                 GType                       exten_type,
+                                 const gchar                *key,
+                                 const gchar                *value,
+                                 PeasExtensionSetFilterFunc  func,
+                                 gpointer                    data,
+                                 GDestroyNotify              destroy,
+                                 const gchar                *first_property,
+                                 ...)
+{
+  PeasExtensionSetFilter filter;
+  va_list var_args;
+  PeasExtensionSet *set;
+
+  g_return_val_if_fail (key != NULL || value == NULL, NULL);
+
+  filter.key = (gchar *) key;
+  filter.value = (gchar *) value;
+  filter.func = func;
+  filter.data = data;
+  filter.destroy = destroy;
+
+  va_start (var_args, first_property);
+  set = extension_set_new_valist_full (engine, exten_type, 0, &filter,
+                                       first_property, var_args);
+  va_end (var_args);
+
+  return set;
+}
+
+/**
+ * peas_extension_set_new_sharedv:
+ * @engine: A #PeasEngine.
+ * @exten_type: the extension #GType.
+ * @n_parameters: the length of the @parameters array.
+ * @parameters: an array of #GParameter.
+ *
+ * Create a new #PeasExtensionSet for the @exten_type extension type,
+ * sharing its extensions with other sets.
+ *
+ * See peas_extension_set_new_shared() for more information.
+ *
+ * Returns: (transfer full): a new instance of #PeasExtensionSet.
+ */
+PeasExtensionSet *
+peas_extension_set_new_sharedv (PeasEngine *engine,
+                                GType       exten_type,
+                                guint       n_parameters,
+                                GParameter *parameters)
+{
+  return extension_set_new_full (engine, exten_type, SET_SHARED, NULL,
+                                 n_parameters, parameters);
+}
+
+/**
+ * peas_extension_set_new_shared:
+ * @engine: A #PeasEngine.
+ * @exten_type: the extension #GType.
+ * @first_property: the name of the first property.
+ * @Varargs: the value of the first property, followed optionally by more
+ *   name/value pairs, followed by %NULL.
+ *
+ * Create a new #PeasExtensionSet for the @exten_type extension type,
+ * sharing its extensions with other sets.
+ *
+ * Unlike peas_extension_set_new(), the extensions are obtained with
+ * peas_engine_get_shared_extensionv(), so the sets created for the same
+ * extension type and construct properties contain the same extension
+ * instances. An extension is destroyed once the last set containing it
+ * drops it.
+ *
+ * Each set still emits #PeasExtensionSet::extension-added and
+ * #PeasExtensionSet::extension-removed for the shared extensions.
+ *
+ * Returns: a new instance of #PeasExtensionSet.
+ */
+PeasExtensionSet *
+peas_extension_set_new_shared (PeasEngine  *engine,
+                               GType        exten_type,
+                               const gchar *first_property,
+                               ...)
+{
+  va_list var_args;
+  PeasExtensionSet *set;
+
+  va_start (var_args, first_property);
+  set = extension_set_new_valist_full (engine, exten_type, SET_SHARED, NULL,
+                                       first_property, var_args);
+  va_end (var_args);
+
+  return set;
+}
@@ -37,6 +37,42 @@ G_BEGIN_DECLS
 #define PEAS_IS_EXTENSION_SET_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), PEAS_TYPE_EXTENSION_SET))
 #define PEAS_EXTENSION_SET_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS((obj), PEAS_TYPE_EXTENSION_SET, PeasExtensionSetClass))
 
+/**
+ * PEAS_EXTENSION_SET_ERROR:
+ *
+ * Error domain for #PeasExtensionSet. Errors in this domain will be from
+ * the #PeasExtensionSetError enumeration.
+ */
+#define PEAS_EXTENSION_SET_ERROR (peas_extension_set_error_quark ())
+
+/**
+ * PeasExtensionSetError:
+ * @PEAS_EXTENSION_SET_ERROR_CALL_FAILED: A method call failed for some of
+ *     the extensions.
+ *
+ * Error codes returned by #PeasExtensionSet functions.
+ */
+typedef enum {
+  PEAS_EXTENSION_SET_ERROR_CALL_FAILED
+} PeasExtensionSetError;
+
+/**
+ * PeasExtensionSetCallMode:
+ * @PEAS_EXTENSION_SET_CALL_ALL: Call every extension, freeing their
+ *     return values.
+ * @PEAS_EXTENSION_SET_CALL_FIRST_HANDLED: Stop at the first extension
+ *     returning %TRUE, a non-zero number or a non-%NULL pointer.
+ * @PEAS_EXTENSION_SET_CALL_COLLECT: Store the return value of each
+ *     extension, stopping once the array of return values is full.
+ *
+ * How peas_extension_set_call_method_full() dispatches a call.
+ */
+typedef enum {
+  PEAS_EXTENSION_SET_CALL_ALL,
+  PEAS_EXTENSION_SET_CALL_FIRST_HANDLED,
+  PEAS_EXTENSION_SET_CALL_COLLECT
+} PeasExtensionSetCallMode;
+
 typedef struct _PeasExtensionSet         PeasExtensionSet;
 typedef struct _PeasExtensionSetClass    PeasExtensionSetClass;
 typedef struct _PeasExtensionSetPrivate  PeasExtensionSetPrivate;
@@ -68,12 +104,78 @@ struct _PeasExtensionSetClass {
   void       (*extension_removed)         (PeasExtensionSet *set,
                                            PeasPluginInfo   *info,
                                            PeasExtension    *exten);
+  void       (*extensions_added)          (PeasExtensionSet *set,
+                                           GPtrArray        *infos,
+                                           GPtrArray        *extensions);
+  void       (*extensions_removed)        (PeasExtensionSet *set,
+                                           GPtrArray        *infos,
+                                           GPtrArray        *extensions);
 };
 
+/**
+ * PeasExtensionSetCompareFunc:
+ * @a: The #PeasPluginInfo of a first extension.
+ * @b: The #PeasPluginInfo of a second extension.
+ * @data: Optional data passed to peas_extension_set_set_sort_func().
+ *
+ * Compares the extensions of two plugins to order a #PeasExtensionSet.
+ *
+ * Returns: a negative value if the extension of @a comes before the one
+ *   of @b, a positive value if it comes after it, and 0 if they are equal.
+ */
+typedef gint (*PeasExtensionSetCompareFunc) (PeasPluginInfo *a,
+                                             PeasPluginInfo *b,
+                                             gpointer        data);
+
+/**
+ * PeasExtensionSetFilterFunc:
+ * @info: A loaded #PeasPluginInfo.
+ * @data: Optional data passed to peas_extension_set_new_filtered().
+ *
+ * Selects the plugins whose extensions a #PeasExtensionSet contains.
+ *
+ * Returns: %TRUE if the set should contain the extension of @info.
+ */
+typedef gboolean (*PeasExtensionSetFilterFunc) (PeasPluginInfo *info,
+                                                gpointer        data);
+
+/**
+ * PeasExtensionSetForeachFunc:
+ * @set: A #PeasExtensionSet.
+ * @info: The #PeasPluginInfo of the plugin providing @exten.
+ * @exten: A #PeasExtension.
+ * @data: Optional data passed to the function.
+ *
+ * This function is called for each extension by
+ * peas_extension_set_foreach().
+ */
+typedef void (*PeasExtensionSetForeachFunc) (PeasExtensionSet *set,
+                                             PeasPluginInfo   *info,
+                                             PeasExtension    *exten,
+                                             gpointer          data);
+
+/**
+ * PeasExtensionSetResultFunc:
+ * @set: A #PeasExtensionSet.
+ * @info: The #PeasPluginInfo of the plugin providing @exten.
+ * @exten: A #PeasExtension.
+ * @return_value: The value returned by the method called on @exten.
+ * @data: Optional data passed to the function.
+ *
+ * This function is called with the result of the call of each extension
+ * by peas_extension_set_call_parallel().
+ */
+typedef void (*PeasExtensionSetResultFunc) (PeasExtensionSet *set,
+                                            PeasPluginInfo   *info,
+                                            PeasExtension    *exten,
+                                            GIArgument       *return_value,
+                                            gpointer          data);
+
 /*
  * Public methods
  */
 GType              peas_extension_set_get_type    (void)  G_GNUC_CONST;
+GQuark             peas_extension_set_error_quark (void);
 
 gboolean           peas_extension_set_call        (PeasExtensionSet *set,
                                                    const gchar      *method_name,
@@ -85,8 +187,42 @@ gboolean           peas_extension_set_callv       (PeasExtensionSet *set,
                                                    const gchar      *method_name,
                                                    GIArgument       *args);
 
+gboolean           peas_extension_set_call_method (PeasExtensionSet *set,
+                                                   PeasMethod       *method,
+                                                   ...);
+gboolean           peas_extension_set_call_method_valist
+                                                  (PeasExtensionSet *set,
+                                                   PeasMethod       *method,
+                                                   va_list           va_args);
+gboolean           peas_extension_set_call_methodv
+                                                  (PeasExtensionSet *set,
+                                                   PeasMethod       *method,
+                                                   GIArgument       *args);
+guint              peas_extension_set_call_method_full
+                                                  (PeasExtensionSet *set,
+                                                   PeasMethod       *method,
+                                                   PeasExtensionSetCallMode mode,
+                                                   GIArgument       *args,
+                                                   GIArgument       *return_values,
+                                                   guint             n_return_values);
+gboolean           peas_extension_set_call_parallel
+                                                  (PeasExtensionSet *set,
+                                                   PeasMethod       *method,
+                                                   GIArgument       *args,
+                                                   PeasExtensionSetResultFunc func,
+                                                   gpointer          data,
+                                                   GError          **error);
+
 PeasExtension     *peas_extension_set_get_extension (PeasExtensionSet *set,
                                                      PeasPluginInfo   *info);
+void               peas_extension_set_foreach     (PeasExtensionSet *set,
+                                                   PeasExtensionSetForeachFunc func,
+                                                   gpointer          data);
+void               peas_extension_set_set_sort_func
+                                                  (PeasExtensionSet *set,
+                                                   PeasExtensionSetCompareFunc func,
+                                                   gpointer          data,
+                                                   GDestroyNotify    destroy);
 
 PeasExtensionSet  *peas_extension_set_newv        (PeasEngine       *engine,
                                                    GType             exten_type,
@@ -100,6 +236,32 @@ PeasExtensionSet  *peas_extension_set_new         (PeasEngine       *engine,
                                                    GType             exten_type,
                                                    const gchar      *first_property,
                                                    ...);
+PeasExtensionSet  *peas_extension_set_new_filtered
+                                                  (PeasEngine       *engine,
+                                                   GType             exten_type,
+                                                   const gchar      *key,
+                                                   const gchar      *value,
+                                                   PeasExtensionSetFilterFunc func,
+                                                   gpointer          data,
+                                                   GDestroyNotify    destroy,
+                                                   const gchar      *first_property,
+                                                   ...);
+PeasExtensionSet  *peas_extension_set_new_sharedv (PeasEngine       *engine,
+                                                   GType             exten_type,
+                                                   guint             n_parameters,
+                                                   GParameter       *parameters);
+PeasExtensionSet  *peas_extension_set_new_shared  (PeasEngine       *engine,
+                                                   GType             exten_type,
+                                                   const gchar      *first_property,
+                                                   ...);
+PeasExtensionSet  *peas_extension_set_new_lazyv   (PeasEngine       *engine,
+                                                   GType             exten_type,
+                                                   guint             n_parameters,
+                                                   GParameter       *parameters);
+PeasExtensionSet  *peas_extension_set_new_lazy    (PeasEngine       *engine,
+                                                   GType             exten_type,
+                                                   const gchar      *first_property,
+                                                   ...);
 
 G_END_DECLS
 
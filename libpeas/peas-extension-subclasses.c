@@ -36,6 +36,15 @@ typedef struct _MethodImpl {
   ffi_cif cif;
   ffi_closure *closure;
   guint struct_offset;
+
+  /* Computed once so the calls only have to convert the arguments,
+   * the instance being the first argument */
+  PeasMethod *method;
+  guint n_args;
+  GITypeInfo **arg_type_infos;
+  GIDirection *directions;
+  GITypeInfo *return_type_info;
+  gboolean returns_void;
 } MethodImpl;
 
 static GQuark
@@ -56,61 +65,88 @@ handle_method_impl (ffi_cif  *cif,
                     gpointer  data)
 {
   MethodImpl *impl = (MethodImpl *) data;
-  GIArgInfo *arg_info;
-  GITypeInfo *type_info;
-  GITypeInfo *return_type_info;
-  gint n_args, i;
+  guint i;
   PeasExtension *instance;
+  GObject *native_instance;
+  gpointer native_vtable;
   GIArgument *arguments;
   GIArgument return_value;
 
   instance = *((PeasExtension **) args[0]);
   g_assert (PEAS_IS_EXTENSION (instance));
+  g_return_if_fail (impl->n_args >= 1);
 
-  n_args = g_callable_info_get_n_args (impl->info);
-  g_return_if_fail (n_args >= 1);
-  arguments = g_newa (GIArgument, n_args-1);
-
-  for (i = 1; i < n_args; i++)
+  /* Call the implementation of the native object directly, with the
+   * very same arguments but for the instance. */
+  native_instance = peas_extension_get_native (instance, &native_vtable);
+  if (native_instance != NULL)
     {
-      arg_info = g_callable_info_get_arg (impl->info, i);
-      type_info = g_arg_info_get_type (arg_info);
+      gpointer address;
 
-      peas_gi_pointer_to_argument (type_info, args[i], &arguments[i-1]);
+      address = G_STRUCT_MEMBER (gpointer, native_vtable, impl->struct_offset);
 
-      g_base_info_unref (type_info);
-      g_base_info_unref (arg_info);
+      if (address != NULL)
+        {
+          gpointer *native_args;
+
+          native_args = g_newa (gpointer, impl->n_args);
+          native_args[0] = &native_instance;
+
+          for (i = 1; i < impl->n_args; i++)
+            native_args[i] = args[i];
+
+          ffi_call (&impl->cif, address, result, native_args);
+          return;
+        }
     }
 
-  peas_extension_callv (instance, impl->method_name, arguments, &return_value);
+  arguments = g_newa (GIArgument, impl->n_args - 1);
+
+  for (i = 1; i < impl->n_args; i++)
+    peas_gi_pointer_to_argument (impl->arg_type_infos[i], args[i],
+                                 &arguments[i - 1]);
 
-  for (i = 1; i < n_args; i++)
+  peas_extension_call_methodv (instance, impl->method, arguments,
+                               &return_value);
+
+  for (i = 1; i < impl->n_args; i++)
     {
-      GIDirection direction;
+      if (impl->directions[i] != GI_DIRECTION_IN)
+        peas_gi_argument_to_pointer (impl->arg_type_infos[i],
+                                     &arguments[i - 1], args[i]);
+    }
 
-      arg_info = g_callable_info_get_arg (impl->info, i);
-      direction = g_arg_info_get_direction (arg_info);
+  if (!impl->returns_void)
+    peas_gi_argument_to_pointer (impl->return_type_info, &return_value, result);
+}
 
-      if (direction == GI_DIRECTION_OUT || direction == GI_DIRECTION_INOUT)
-        {
-          type_info = g_arg_info_get_type (arg_info);
-          peas_gi_argument_to_pointer (type_info, &arguments[i-1], args[i]);
-          g_base_info_unref (type_info);
-        }
+static void
+prepare_method_impl (MethodImpl *impl)
+{
+  guint i;
 
-      g_base_info_unref (arg_info);
-    }
+  impl->n_args = g_callable_info_get_n_args (impl->info);
+  impl->arg_type_infos = g_new (GITypeInfo *, impl->n_args);
+  impl->directions = g_new (GIDirection, impl->n_args);
 
-  return_type_info = g_callable_info_get_return_type (impl->info);
+  for (i = 0; i < impl->n_args; i++)
+    {
+      GIArgInfo *arg_info;
 
-  if (g_type_info_get_tag (return_type_info) != GI_TYPE_TAG_VOID)
-    peas_gi_argument_to_pointer (return_type_info, &return_value, result);
+      arg_info = g_callable_info_get_arg (impl->info, i);
+      impl->arg_type_infos[i] = g_arg_info_get_type (arg_info);
+      impl->directions[i] = g_arg_info_get_direction (arg_info);
+      g_base_info_unref (arg_info);
+    }
 
-  g_base_info_unref (return_type_info);
+  impl->return_type_info = g_callable_info_get_return_type (impl->info);
+  impl->returns_void =
+      g_type_info_get_tag (impl->return_type_info) == GI_TYPE_TAG_VOID;
 }
 
 static void
-create_native_closure (GIInterfaceInfo *iface_info,
+create_native_closure (GType            exten_type,
+                       GIInterfaceInfo *iface_info,
                        GIVFuncInfo     *vfunc_info,
                        MethodImpl      *impl)
 {
@@ -166,8 +202,21 @@ create_native_closure (GIInterfaceInfo *iface_info,
   callback_info = g_type_info_get_interface (type_info);
   g_assert (g_base_info_get_type (callback_info) == GI_INFO_TYPE_CALLBACK);
 
+  impl->method = peas_method_new (exten_type,
+                                  g_base_info_get_name (invoker_info));
+  if (impl->method == NULL)
+    {
+      g_base_info_unref (callback_info);
+      g_base_info_unref (type_info);
+      g_base_info_unref (field_info);
+      g_base_info_unref (struct_info);
+      g_base_info_unref (invoker_info);
+      return;
+    }
+
   impl->info = g_base_info_ref (callback_info);
   impl->method_name = g_strdup (g_base_info_get_name (invoker_info));
+  prepare_method_impl (impl);
   impl->closure = g_callable_info_prepare_closure (callback_info, &impl->cif,
                                                    handle_method_impl, impl);
   impl->struct_offset = g_field_info_get_offset (field_info);
@@ -207,7 +256,8 @@ implement_interface_methods (gpointer iface,
         {
           GIVFuncInfo *vfunc_info;
           vfunc_info = g_interface_info_get_vfunc (iface_info, i);
-          create_native_closure (iface_info, vfunc_info, &impls[i]);
+          create_native_closure (exten_type, iface_info, vfunc_info,
+                                 &impls[i]);
           g_base_info_unref ((GIBaseInfo *) vfunc_info);
         }
 
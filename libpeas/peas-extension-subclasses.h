@@ -24,10 +24,17 @@
 
 #include <glib-object.h>
 
+#include "peas-extension.h"
+
 G_BEGIN_DECLS
 
-GType         peas_extension_register_subclass      (GType parent_type,
-                                                     GType extension_type);
+GType         peas_extension_register_subclass      (GType          parent_type,
+                                                     GType          extension_type);
+
+/* Implemented in peas-extension.c */
+void          peas_extension_set_native             (PeasExtension *exten,
+                                                     GObject       *instance,
+                                                     gpointer       vtable);
 
 G_END_DECLS
 
@@ -24,7 +24,9 @@
 #endif
 
 #include "peas-extension.h"
+#include "peas-extension-subclasses.h"
 #include "peas-introspection.h"
+#include "peas-method-priv.h"
 
 /**
  * SECTION:peas-extension
@@ -51,12 +53,13 @@
  * you want to use as extension points. GObject-introspection data is required
  * for all the supported languages, even for C.
  *
- * #PeasExtension does not provide any way to access the underlying object.
- * The main reason is that some loaders may not rely on proper GObject
- * inheritance for the definition of extensions, and hence it would not be
- * possible for libpeas to provide a functional GObject instance at all.
- * Another reason is that it makes reference counting issues easier to deal
- * with.
+ * In general, #PeasExtension does not provide access to the underlying
+ * object. The main reason is that some loaders may not rely on proper
+ * GObject inheritance for the definition of extensions, and hence it would
+ * not be possible for libpeas to provide a functional GObject instance at
+ * all. Another reason is that it makes reference counting issues easier
+ * to deal with. Only C extensions expose their object, through
+ * peas_extension_get_native(), for code generated by peas-codegen.
  *
  * See peas_extension_call() for more information.
  **/
@@ -71,6 +74,10 @@ enum {
 
 struct _PeasExtensionPrivate {
   GType exten_type;
+
+  /* See peas_extension_set_native() */
+  GObject *native_instance;
+  gpointer native_vtable;
 };
 
 static void
@@ -155,6 +162,57 @@ peas_extension_get_extension_type (PeasExtension *exten)
   return exten->priv->exten_type;
 }
 
+/*
+ * peas_extension_set_native:
+ * @exten: A #PeasExtension.
+ * @instance: The native #GObject behind @exten.
+ * @vtable: The result of peas_gi_get_vtable() for @instance.
+ *
+ * Lets the proxy subclasses of @exten forward the vfuncs of the extension
+ * type straight to the implementations of @instance. The loader must keep
+ * @instance alive as long as @exten.
+ */
+void
+peas_extension_set_native (PeasExtension *exten,
+                           GObject       *instance,
+                           gpointer       vtable)
+{
+  g_return_if_fail (PEAS_IS_EXTENSION (exten));
+  g_return_if_fail (G_IS_OBJECT (instance));
+
+  exten->priv->native_instance = instance;
+  exten->priv->native_vtable = vtable;
+}
+
+/**
+ * peas_extension_get_native: (skip)
+ * @exten: A #PeasExtension.
+ * @vtable: (allow-none): Where to store the interface or class structure
+ *   of the native instance for the extension type, or %NULL.
+ *
+ * Gets the #GObject implementing the extension type behind @exten, when
+ * the loader provides one. This is the case for C extensions, and lets
+ * generated code call the vfuncs of the extension type directly, without
+ * going through peas_extension_call_methodv(). The extensions of the
+ * other loaders have no native instance.
+ *
+ * The instance is owned by @exten and lives as long as it does.
+ *
+ * Return value: (transfer none): the native instance, or %NULL if @exten
+ *   has none.
+ */
+GObject *
+peas_extension_get_native (PeasExtension *exten,
+                           gpointer      *vtable)
+{
+  g_return_val_if_fail (PEAS_IS_EXTENSION (exten), NULL);
+
+  if (vtable != NULL)
+    *vtable = exten->priv->native_vtable;
+
+  return exten->priv->native_instance;
+}
+
 /**
  * peas_extension_call:
  * @exten: A #PeasExtension.
@@ -211,34 +269,26 @@ peas_extension_call_valist (PeasExtension *exten,
                             const gchar   *method_name,
                             va_list        args)
 {
-  GICallableInfo *callable_info;
-  GITypeInfo *retval_info;
+  const PeasCallPlan *plan;
   GIArgument *gargs;
   GIArgument retval;
   gpointer retval_ptr;
   gboolean ret;
-  gint n_args;
 
   g_return_val_if_fail (PEAS_IS_EXTENSION (exten), FALSE);
   g_return_val_if_fail (method_name != NULL, FALSE);
 
-  callable_info = peas_gi_get_method_info (exten->priv->exten_type, method_name);
-  if (callable_info == NULL)
+  plan = peas_gi_get_call_plan (exten->priv->exten_type, method_name);
+  if (plan == NULL)
     return FALSE;
 
-  n_args = g_callable_info_get_n_args (callable_info);
-  g_return_val_if_fail (n_args >= 0, FALSE);
-  gargs = g_newa (GIArgument, n_args);
-  peas_gi_valist_to_arguments (callable_info, args, gargs, &retval_ptr);
+  gargs = g_newa (GIArgument, plan->n_args);
+  peas_gi_call_plan_valist_to_arguments (plan, args, gargs, &retval_ptr);
 
   ret = peas_extension_callv (exten, method_name, gargs, &retval);
 
   if (retval_ptr != NULL)
-    {
-      retval_info = g_callable_info_get_return_type (callable_info);
-      peas_gi_argument_to_pointer (retval_info, &retval, retval_ptr);
-      g_base_info_unref ((GIBaseInfo *) retval_info);
-    }
+    peas_gi_argument_to_pointer (plan->return_type_info, &retval, retval_ptr);
 
   return ret;
 }
@@ -257,3 +307,106 @@ peas_extension_callv (PeasExtension *exten,
   klass = PEAS_EXTENSION_GET_CLASS (exten);
   return klass->call (exten, method_name, args, return_value);
 }
+
+/**
+ * peas_extension_call_method:
+ * @exten: A #PeasExtension.
+ * @method: A #PeasMethod of the extension type of @exten.
+ * @Varargs: arguments for the method.
+ *
+ * Call @method on the object behind @extension.
+ *
+ * This behaves like peas_extension_call(), but as @method was resolved
+ * beforehand it does not need to look the method up.
+ *
+ * Return value: %TRUE on successful call.
+ */
+gboolean
+peas_extension_call_method (PeasExtension *exten,
+                            PeasMethod    *method,
+                            ...)
+{
+  va_list args;
+  gboolean result;
+
+  va_start (args, method);
+  result = peas_extension_call_method_valist (exten, method, args);
+  va_end (args);
+
+  return result;
+}
+
+/**
+ * peas_extension_call_method_valist:
+ * @exten: A #PeasExtension.
+ * @method: A #PeasMethod of the extension type of @exten.
+ * @args: the arguments for the method.
+ *
+ * Call @method on the object behind @extension, using @args as arguments.
+ *
+ * See peas_extension_call_method() for more information.
+ *
+ * Return value: %TRUE on successful call.
+ */
+gboolean
+peas_extension_call_method_valist (PeasExtension *exten,
+                                   PeasMethod    *method,
+                                   va_list        args)
+{
+  GIArgument *gargs;
+  GIArgument retval;
+  gpointer retval_ptr;
+  gboolean ret;
+
+  g_return_val_if_fail (PEAS_IS_EXTENSION (exten), FALSE);
+  g_return_val_if_fail (method != NULL, FALSE);
+
+  gargs = g_newa (GIArgument, method->plan->n_args);
+  peas_gi_call_plan_valist_to_arguments (method->plan, args, gargs, &retval_ptr);
+
+  ret = peas_extension_call_methodv (exten, method, gargs, &retval);
+
+  if (retval_ptr != NULL)
+    peas_gi_argument_to_pointer (method->plan->return_type_info, &retval,
+                                 retval_ptr);
+
+  return ret;
+}
+
+/**
+ * peas_extension_call_methodv:
+ * @exten: A #PeasExtension.
+ * @method: A #PeasMethod of the extension type of @exten.
+ * @args: the arguments for the method.
+ * @return_value: the return value of the method.
+ *
+ * Call @method on the object behind @extension, using @args as arguments.
+ *
+ * See peas_extension_call_method() for more information.
+ *
+ * Return value: %TRUE on successful call.
+ */
+gboolean
+peas_extension_call_methodv (PeasExtension *exten,
+                             PeasMethod    *method,
+                             GIArgument    *args,
+                             GIArgument    *return_value)
+{
+  PeasExtensionClass *klass;
+
+  g_return_val_if_fail (PEAS_IS_EXTENSION (exten), FALSE);
+  g_return_val_if_fail (method != NULL, FALSE);
+  g_return_val_if_fail (method->plan->iface_type == exten->priv->exten_type,
+                        FALSE);
+
+  /* The call plan applies directly to native instances, the class
+   * structure is kept as it was so this does not change the ABI */
+  if (exten->priv->native_instance != NULL)
+    return peas_method_apply_vfunc (exten->priv->native_instance,
+                                    exten->priv->native_vtable,
+                                    method->plan, args, return_value);
+
+  /* Loaders which can't make use of the call plan dispatch by name */
+  klass = PEAS_EXTENSION_GET_CLASS (exten);
+  return klass->call (exten, method->plan->method_name, args, return_value);
+}
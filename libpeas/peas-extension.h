@@ -25,6 +25,8 @@
 #include <glib-object.h>
 #include <girepository.h>
 
+#include "peas-method.h"
+
 G_BEGIN_DECLS
 
 /*
@@ -78,6 +80,8 @@ GType        peas_extension_get_type        (void)  G_GNUC_CONST;
 
 GType        peas_extension_get_extension_type
                                             (PeasExtension *exten);
+GObject     *peas_extension_get_native      (PeasExtension *exten,
+                                             gpointer      *vtable);
 
 gboolean     peas_extension_call            (PeasExtension *exten,
                                              const gchar   *method_name,
@@ -90,6 +94,18 @@ gboolean     peas_extension_callv           (PeasExtension *exten,
                                              GIArgument    *args,
                                              GIArgument    *return_value);
 
+gboolean     peas_extension_call_method     (PeasExtension *exten,
+                                             PeasMethod    *method,
+                                             ...);
+gboolean     peas_extension_call_method_valist
+                                            (PeasExtension *exten,
+                                             PeasMethod    *method,
+                                             va_list        args);
+gboolean     peas_extension_call_methodv    (PeasExtension *exten,
+                                             PeasMethod    *method,
+                                             GIArgument    *args,
+                                             GIArgument    *return_value);
+
 G_END_DECLS
 
 #endif /* __PEAS_EXTENSION_H__ */
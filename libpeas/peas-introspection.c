@@ -23,31 +23,214 @@
 #include <config.h>
 #endif
 
+#include <girffi.h>
+
 #include "peas-introspection.h"
 
-void
-peas_gi_valist_to_arguments (GICallableInfo *callable_info,
-                             va_list         va_args,
-                             GIArgument     *arguments,
-                             gpointer       *return_value)
+/* The call plans of the methods, keyed by interface type and interned
+ * method name, as looking the methods up in the repository means a linear
+ * search of the methods of the interface. */
+typedef struct {
+  GType iface_type;
+  const gchar *method_name;
+} CallPlanKey;
+
+G_LOCK_DEFINE_STATIC (call_plans);
+static GHashTable *call_plans = NULL;
+
+static guint
+call_plan_key_hash (gconstpointer data)
 {
-  gint i, n_args;
-  GIArgInfo *arg_info;
-  GITypeInfo *arg_type_info;
-  GITypeInfo *retval_info;
-  GIArgument *cur_arg;
+  const CallPlanKey *key = (const CallPlanKey *) data;
 
-  g_return_if_fail (callable_info != NULL);
+  return ((guint) key->iface_type) ^ g_direct_hash (key->method_name);
+}
 
-  n_args = g_callable_info_get_n_args (callable_info);
+static gboolean
+call_plan_key_equal (gconstpointer a,
+                     gconstpointer b)
+{
+  const CallPlanKey *key_a = (const CallPlanKey *) a;
+  const CallPlanKey *key_b = (const CallPlanKey *) b;
 
-  for (i = 0; i < n_args; i++)
+  return key_a->iface_type == key_b->iface_type &&
+         key_a->method_name == key_b->method_name;
+}
+
+static void
+call_plan_key_free (CallPlanKey *key)
+{
+  g_slice_free (CallPlanKey, key);
+}
+
+/* Gets the offset in the class or interface structure of the vfunc
+ * the method is a mere wrapper of, or -1 if there is none. */
+static gint
+find_vfunc_offset (GICallableInfo *callable_info)
+{
+  GIBaseInfo *container;
+  GIVFuncInfo *vfunc_info = NULL;
+  GIFunctionInfo *invoker_info;
+  const gchar *method_name;
+  gint offset = -1;
+
+  container = g_base_info_get_container ((GIBaseInfo *) callable_info);
+  method_name = g_base_info_get_name ((GIBaseInfo *) callable_info);
+
+  switch (g_base_info_get_type (container))
+    {
+    case GI_INFO_TYPE_OBJECT:
+      vfunc_info = g_object_info_find_vfunc ((GIObjectInfo *) container,
+                                             method_name);
+      break;
+    case GI_INFO_TYPE_INTERFACE:
+      vfunc_info = g_interface_info_find_vfunc ((GIInterfaceInfo *) container,
+                                                method_name);
+      break;
+    default:
+      break;
+    }
+
+  if (vfunc_info == NULL)
+    return -1;
+
+  /* Only trust a vfunc which has the method as its invoker, the method
+   * could do more than calling it otherwise. */
+  invoker_info = g_vfunc_info_get_invoker (vfunc_info);
+
+  if (invoker_info != NULL)
+    {
+      if (g_strcmp0 (g_base_info_get_name ((GIBaseInfo *) invoker_info),
+                     method_name) == 0)
+        offset = g_vfunc_info_get_offset (vfunc_info);
+
+      g_base_info_unref ((GIBaseInfo *) invoker_info);
+    }
+
+  g_base_info_unref ((GIBaseInfo *) vfunc_info);
+
+  /* 0xFFFF means the offset is unknown */
+  return offset == 0xFFFF ? -1 : offset;
+}
+
+static PeasCallPlan *
+call_plan_new (GType           iface_type,
+               const gchar    *method_name,
+               GICallableInfo *callable_info)
+{
+  PeasCallPlan *plan;
+  guint i;
+  GError *error = NULL;
+
+  plan = g_slice_new0 (PeasCallPlan);
+  plan->vfunc_offset = -1;
+  plan->iface_type = iface_type;
+  plan->method_name = method_name;
+  plan->callable_info = callable_info;
+
+  plan->n_args = g_callable_info_get_n_args (callable_info);
+  plan->directions = g_new (GIDirection, plan->n_args);
+  plan->tags = g_new (GITypeTag, plan->n_args);
+  plan->in_indexes = g_new (guint, plan->n_args);
+  plan->out_indexes = g_new (guint, plan->n_args);
+
+  for (i = 0; i < plan->n_args; i++)
     {
+      GIArgInfo *arg_info;
+      GITypeInfo *arg_type_info;
+
       arg_info = g_callable_info_get_arg (callable_info, i);
       arg_type_info = g_arg_info_get_type (arg_info);
+
+      plan->directions[i] = g_arg_info_get_direction (arg_info);
+      plan->tags[i] = g_type_info_get_tag (arg_type_info);
+
+      if (plan->directions[i] != GI_DIRECTION_OUT)
+        plan->in_indexes[plan->n_in_args++] = i;
+      if (plan->directions[i] != GI_DIRECTION_IN)
+        plan->out_indexes[plan->n_out_args++] = i;
+
+      g_base_info_unref ((GIBaseInfo *) arg_type_info);
+      g_base_info_unref ((GIBaseInfo *) arg_info);
+    }
+
+  plan->return_type_info = g_callable_info_get_return_type (callable_info);
+  plan->return_tag = g_type_info_get_tag (plan->return_type_info);
+
+  if (plan->return_tag == GI_TYPE_TAG_INTERFACE)
+    {
+      GIBaseInfo *iface_info;
+      GIInfoType info_type;
+
+      iface_info = g_type_info_get_interface (plan->return_type_info);
+      info_type = g_base_info_get_type (iface_info);
+      plan->return_is_enum = info_type == GI_INFO_TYPE_ENUM ||
+                             info_type == GI_INFO_TYPE_FLAGS;
+      g_base_info_unref (iface_info);
+    }
+
+  /* Methods throwing errors go through g_function_info_invoke() */
+  if ((g_function_info_get_flags ((GIFunctionInfo *) callable_info) & GI_FUNCTION_THROWS) == 0)
+    {
+      GIFunctionInvoker *invoker = g_slice_new (GIFunctionInvoker);
+
+      if (g_function_info_prep_invoker ((GIFunctionInfo *) callable_info,
+                                        invoker, &error))
+        {
+          plan->invoker = invoker;
+        }
+      else
+        {
+          g_debug ("Could not prepare the call to '%s': %s",
+                   g_base_info_get_name ((GIBaseInfo *) callable_info),
+                   error->message);
+          g_error_free (error);
+          g_slice_free (GIFunctionInvoker, invoker);
+        }
+    }
+
+  if (plan->invoker != NULL)
+    plan->vfunc_offset = find_vfunc_offset (callable_info);
+
+  return plan;
+}
+
+static void
+call_plan_free (PeasCallPlan *plan)
+{
+  if (plan->invoker != NULL)
+    {
+      g_function_invoker_destroy ((GIFunctionInvoker *) plan->invoker);
+      g_slice_free (GIFunctionInvoker, plan->invoker);
+    }
+
+  g_base_info_unref ((GIBaseInfo *) plan->return_type_info);
+  g_free (plan->directions);
+  g_free (plan->tags);
+  g_free (plan->in_indexes);
+  g_free (plan->out_indexes);
+  g_base_info_unref ((GIBaseInfo *) plan->callable_info);
+
+  g_slice_free (PeasCallPlan, plan);
+}
+
+static void
+valist_to_arguments (guint              n_args,
+                     const GIDirection *directions,
+                     const GITypeTag   *tags,
+                     GITypeTag          return_tag,
+                     va_list            va_args,
+                     GIArgument        *arguments,
+                     gpointer          *return_value)
+{
+  guint i;
+  GIArgument *cur_arg;
+
+  for (i = 0; i < n_args; i++)
+    {
       cur_arg = &arguments[i];
 
-      switch (g_arg_info_get_direction (arg_info))
+      switch (directions[i])
         {
         case GI_DIRECTION_IN:
           {
@@ -55,7 +238,7 @@ peas_gi_valist_to_arguments (GICallableInfo *callable_info,
              *  - int8, uint8, int16, uint16, short and ushort are promoted to int when passed through '...'
              *  - float is promoted to double when passed through '...'
              */
-            switch (g_type_info_get_tag (arg_type_info))
+            switch (tags[i])
               {
               case GI_TYPE_TAG_VOID:
               case GI_TYPE_TAG_BOOLEAN:
@@ -120,59 +303,67 @@ peas_gi_valist_to_arguments (GICallableInfo *callable_info,
           cur_arg->v_pointer = va_arg (va_args, gpointer);
           break;
         }
-
-      g_base_info_unref ((GIBaseInfo *) arg_type_info);
-      g_base_info_unref ((GIBaseInfo *) arg_info);
     }
 
   if (return_value != NULL)
     {
-      retval_info = g_callable_info_get_return_type (callable_info);
-
-      if (g_type_info_get_tag (retval_info) != GI_TYPE_TAG_VOID)
+      if (return_tag != GI_TYPE_TAG_VOID)
         *return_value = va_arg (va_args, gpointer);
       else
         *return_value = NULL;
-
-      g_base_info_unref ((GIBaseInfo *) retval_info);
     }
 }
 
-static void
-peas_gi_split_in_and_out_arguments (GICallableInfo *callable_info,
-                                    GIArgument     *args,
-                                    GIArgument     *in_args,
-                                    guint          *n_in_args,
-                                    GIArgument     *out_args,
-                                    guint          *n_out_args)
+void
+peas_gi_valist_to_arguments (GICallableInfo *callable_info,
+                             va_list         va_args,
+                             GIArgument     *arguments,
+                             gpointer       *return_value)
 {
-  gint n_args, i;
+  gint i, n_args;
+  GIDirection *directions;
+  GITypeTag *tags;
   GIArgInfo *arg_info;
+  GITypeInfo *arg_type_info;
+  GITypeInfo *retval_info;
+  GITypeTag return_tag;
 
   g_return_if_fail (callable_info != NULL);
 
   n_args = g_callable_info_get_n_args (callable_info);
+  directions = g_newa (GIDirection, n_args);
+  tags = g_newa (GITypeTag, n_args);
 
   for (i = 0; i < n_args; i++)
     {
       arg_info = g_callable_info_get_arg (callable_info, i);
+      arg_type_info = g_arg_info_get_type (arg_info);
 
-      switch (g_arg_info_get_direction (arg_info))
-        {
-        case GI_DIRECTION_IN:
-          in_args[(*n_in_args)++] = args[i];
-          break;
-        case GI_DIRECTION_INOUT:
-          in_args[(*n_in_args)++] = args[i];
-          out_args[(*n_out_args)++] = args[i];
-          break;
-        case GI_DIRECTION_OUT:
-          out_args[(*n_out_args)++] = args[i];
-          break;
-        }
+      directions[i] = g_arg_info_get_direction (arg_info);
+      tags[i] = g_type_info_get_tag (arg_type_info);
 
+      g_base_info_unref ((GIBaseInfo *) arg_type_info);
       g_base_info_unref ((GIBaseInfo *) arg_info);
     }
+
+  retval_info = g_callable_info_get_return_type (callable_info);
+  return_tag = g_type_info_get_tag (retval_info);
+  g_base_info_unref ((GIBaseInfo *) retval_info);
+
+  valist_to_arguments (n_args, directions, tags, return_tag,
+                       va_args, arguments, return_value);
+}
+
+void
+peas_gi_call_plan_valist_to_arguments (const PeasCallPlan *plan,
+                                       va_list             va_args,
+                                       GIArgument         *arguments,
+                                       gpointer           *return_value)
+{
+  g_return_if_fail (plan != NULL);
+
+  valist_to_arguments (plan->n_args, plan->directions, plan->tags,
+                       plan->return_tag, va_args, arguments, return_value);
 }
 
 void
@@ -301,9 +492,9 @@ peas_gi_pointer_to_argument (GITypeInfo     *type_info,
     }
 }
 
-GICallableInfo *
-peas_gi_get_method_info (GType        iface_type,
-                         const gchar *method_name)
+static GICallableInfo *
+find_method_info (GType        iface_type,
+                  const gchar *method_name)
 {
   GIRepository *repo;
   GIBaseInfo *iface_info;
@@ -343,55 +534,319 @@ peas_gi_get_method_info (GType        iface_type,
   return (GICallableInfo *) func_info;
 }
 
-gboolean
-peas_method_apply (GObject     *instance,
-                   GType        iface_type,
-                   const gchar *method_name,
-                   GIArgument  *args,
-                   GIArgument  *return_value)
+/*
+ * peas_gi_get_call_plan:
+ * @iface_type: The #GType of the interface.
+ * @method_name: The name of the method.
+ *
+ * Gets the call plan of a method, building it the first time. Call plans
+ * are shared by all the threads, and are never freed.
+ *
+ * Return value: the call plan of the method, or %NULL if it was not found.
+ */
+const PeasCallPlan *
+peas_gi_get_call_plan (GType        iface_type,
+                       const gchar *method_name)
 {
+  CallPlanKey key;
+  PeasCallPlan *plan = NULL;
+  PeasCallPlan *new_plan;
   GICallableInfo *func_info;
-  gint n_args;
-  guint n_in_args, n_out_args;
+
+  key.iface_type = iface_type;
+  key.method_name = g_intern_string (method_name);
+
+  G_LOCK (call_plans);
+
+  if (call_plans != NULL)
+    plan = (PeasCallPlan *) g_hash_table_lookup (call_plans, &key);
+
+  G_UNLOCK (call_plans);
+
+  if (plan != NULL)
+    return plan;
+
+  func_info = find_method_info (iface_type, method_name);
+  if (func_info == NULL)
+    return NULL;
+
+  new_plan = call_plan_new (iface_type, key.method_name, func_info);
+
+  G_LOCK (call_plans);
+
+  if (call_plans == NULL)
+    call_plans = g_hash_table_new_full (call_plan_key_hash,
+                                        call_plan_key_equal,
+                                        (GDestroyNotify) call_plan_key_free,
+                                        (GDestroyNotify) call_plan_free);
+
+  /* Another thread may have built it in the meantime */
+  plan = (PeasCallPlan *) g_hash_table_lookup (call_plans, &key);
+
+  if (plan == NULL)
+    {
+      CallPlanKey *new_key;
+
+      new_key = g_slice_new (CallPlanKey);
+      *new_key = key;
+
+      g_hash_table_insert (call_plans, new_key, new_plan);
+      plan = new_plan;
+      new_plan = NULL;
+    }
+
+  G_UNLOCK (call_plans);
+
+  if (new_plan != NULL)
+    call_plan_free (new_plan);
+
+  return plan;
+}
+
+GICallableInfo *
+peas_gi_get_method_info (GType        iface_type,
+                         const gchar *method_name)
+{
+  const PeasCallPlan *plan;
+
+  plan = peas_gi_get_call_plan (iface_type, method_name);
+  if (plan == NULL)
+    return NULL;
+
+  return (GICallableInfo *) g_base_info_ref ((GIBaseInfo *) plan->callable_info);
+}
+
+/* libffi widens the integers it returns to a whole ffi_arg, so they
+ * are narrowed to the right GIArgument member, as gobject-introspection
+ * does. Reading them from the start of the ffi_arg would only work on
+ * little-endian machines. */
+static void
+narrow_return_value (const PeasCallPlan *plan,
+                     ffi_arg             value,
+                     GIArgument         *return_value)
+{
+  switch (plan->return_tag)
+    {
+    case GI_TYPE_TAG_BOOLEAN:
+      return_value->v_boolean = (gboolean) value;
+      break;
+    case GI_TYPE_TAG_INT8:
+      return_value->v_int8 = (gint8) value;
+      break;
+    case GI_TYPE_TAG_UINT8:
+      return_value->v_uint8 = (guint8) value;
+      break;
+    case GI_TYPE_TAG_INT16:
+      return_value->v_int16 = (gint16) value;
+      break;
+    case GI_TYPE_TAG_UINT16:
+      return_value->v_uint16 = (guint16) value;
+      break;
+    case GI_TYPE_TAG_INT32:
+      return_value->v_int32 = (gint32) value;
+      break;
+    case GI_TYPE_TAG_UINT32:
+      return_value->v_uint32 = (guint32) value;
+      break;
+    case GI_TYPE_TAG_INTERFACE:
+      if (plan->return_is_enum)
+        return_value->v_int = (gint) value;
+      else
+        return_value->v_pointer = (gpointer) value;
+      break;
+    default:
+      g_assert_not_reached ();
+    }
+}
+
+/* Calls @address, which has the signature of the method of @plan */
+static void
+invoke_native (const PeasCallPlan *plan,
+               gpointer            address,
+               GObject            *instance,
+               GIArgument         *args,
+               GIArgument         *return_value)
+{
+  GIFunctionInvoker *invoker = (GIFunctionInvoker *) plan->invoker;
+  GIArgument instance_arg;
+  union {
+    ffi_arg narrow;
+    GIArgument wide;
+  } result;
+  gpointer *ffi_args;
+  guint i;
+
+  /* The values of the in arguments and the pointers of the other ones
+   * are at the start of the GIArgument unions, as libffi expects. */
+  ffi_args = g_newa (gpointer, plan->n_args + 1);
+
+  instance_arg.v_pointer = instance;
+  ffi_args[0] = &instance_arg;
+
+  for (i = 0; i < plan->n_args; i++)
+    ffi_args[i + 1] = &args[i];
+
+  ffi_call (&invoker->cif, address, &result, ffi_args);
+
+  /* The types larger than an ffi_arg are stored as they are */
+  switch (plan->return_tag)
+    {
+    case GI_TYPE_TAG_VOID:
+      break;
+    case GI_TYPE_TAG_BOOLEAN:
+    case GI_TYPE_TAG_INT8:
+    case GI_TYPE_TAG_UINT8:
+    case GI_TYPE_TAG_INT16:
+    case GI_TYPE_TAG_UINT16:
+    case GI_TYPE_TAG_INT32:
+    case GI_TYPE_TAG_UINT32:
+    case GI_TYPE_TAG_INTERFACE:
+      narrow_return_value (plan, result.narrow, return_value);
+      break;
+    default:
+      *return_value = result.wide;
+      break;
+    }
+}
+
+/*
+ * peas_method_apply_plan:
+ * @instance: The object implementing the method.
+ * @plan: The call plan of the method, see peas_gi_get_call_plan().
+ * @args: The arguments of the method.
+ * @return_value: Where to store the return value, or %NULL.
+ *
+ * Calls the method described by @plan on @instance, without looking
+ * anything up.
+ *
+ * Return value: %TRUE on successful call.
+ */
+gboolean
+peas_method_apply_plan (GObject            *instance,
+                        const PeasCallPlan *plan,
+                        GIArgument         *args,
+                        GIArgument         *return_value)
+{
   GIArgument *in_args, *out_args;
-  gboolean ret = TRUE;
+  GIArgument dummy_return_value;
+  guint i;
+  gboolean ret;
   GError *error = NULL;
 
-  func_info = peas_gi_get_method_info (iface_type, method_name);
-  if (func_info == NULL)
-    return FALSE;
+  if (return_value == NULL)
+    return_value = &dummy_return_value;
 
-  n_args = g_callable_info_get_n_args (func_info);
-  g_return_val_if_fail (n_args >= 0, FALSE);
-  n_in_args = 0;
-  n_out_args = 0;
+  if (plan->invoker != NULL)
+    {
+      GIFunctionInvoker *invoker = (GIFunctionInvoker *) plan->invoker;
 
-  in_args = g_newa (GIArgument, n_args + 1);
-  out_args = g_newa (GIArgument, n_args);
+      invoke_native (plan, invoker->native_address, instance, args,
+                     return_value);
+      return TRUE;
+    }
 
-  peas_gi_split_in_and_out_arguments (func_info, args,
-                                      in_args+1, &n_in_args,
-                                      out_args, &n_out_args);
+  in_args = g_newa (GIArgument, plan->n_in_args + 1);
+  out_args = g_newa (GIArgument, plan->n_out_args);
 
   /* Set the object as the first argument for the method. */
   in_args[0].v_pointer = instance;
-  n_in_args++;
 
-  g_debug ("Calling '%s.%s' on '%p'",
-           g_type_name (iface_type), method_name, instance);
+  for (i = 0; i < plan->n_in_args; i++)
+    in_args[i + 1] = args[plan->in_indexes[i]];
+
+  for (i = 0; i < plan->n_out_args; i++)
+    out_args[i] = args[plan->out_indexes[i]];
 
-  ret = g_function_info_invoke (func_info, in_args, n_in_args, out_args,
-                                n_out_args, return_value, &error);
+  ret = g_function_info_invoke ((GIFunctionInfo *) plan->callable_info,
+                                in_args, plan->n_in_args + 1,
+                                out_args, plan->n_out_args,
+                                return_value, &error);
   if (!ret)
     {
       g_warning ("Error while calling '%s.%s': %s",
-                 g_type_name (iface_type), method_name, error->message);
+                 g_type_name (plan->iface_type), plan->method_name,
+                 error->message);
       g_error_free (error);
-      goto out;
     }
 
-out:
-  g_base_info_unref ((GIBaseInfo *) func_info);
-
   return ret;
 }
+
+gboolean
+peas_method_apply (GObject     *instance,
+                   GType        iface_type,
+                   const gchar *method_name,
+                   GIArgument  *args,
+                   GIArgument  *return_value)
+{
+  const PeasCallPlan *plan;
+
+  plan = peas_gi_get_call_plan (iface_type, method_name);
+  if (plan == NULL)
+    return FALSE;
+
+  return peas_method_apply_plan (instance, plan, args, return_value);
+}
+
+/*
+ * peas_gi_get_vtable:
+ * @instance: An object implementing @iface_type.
+ * @iface_type: The #GType of an interface or class.
+ *
+ * Gets the structure holding the implementation of the vfuncs of
+ * @iface_type by @instance, to be used with peas_method_apply_vfunc().
+ * It stays valid as long as @instance is alive.
+ *
+ * Return value: the interface or class structure, or %NULL.
+ */
+gpointer
+peas_gi_get_vtable (GObject *instance,
+                    GType    iface_type)
+{
+  if (G_TYPE_IS_INTERFACE (iface_type))
+    return g_type_interface_peek (G_OBJECT_GET_CLASS (instance), iface_type);
+
+  if (G_TYPE_CHECK_INSTANCE_TYPE (instance, iface_type))
+    return G_OBJECT_GET_CLASS (instance);
+
+  return NULL;
+}
+
+/*
+ * peas_method_apply_vfunc:
+ * @instance: The object implementing the method.
+ * @vtable: The result of peas_gi_get_vtable() for @instance, or %NULL.
+ * @plan: The call plan of the method.
+ * @args: The arguments of the method.
+ * @return_value: Where to store the return value, or %NULL.
+ *
+ * Calls the implementation of the method of @plan found in @vtable
+ * directly, skipping the wrapper function of the method. This falls back
+ * to peas_method_apply_plan() when the method does not only wrap a vfunc,
+ * or when @instance does not implement it.
+ *
+ * Return value: %TRUE on successful call.
+ */
+gboolean
+peas_method_apply_vfunc (GObject            *instance,
+                         gpointer            vtable,
+                         const PeasCallPlan *plan,
+                         GIArgument         *args,
+                         GIArgument         *return_value)
+{
+  GIArgument dummy_return_value;
+  gpointer address;
+
+  if (vtable == NULL || plan->vfunc_offset < 0)
+    return peas_method_apply_plan (instance, plan, args, return_value);
+
+  address = G_STRUCT_MEMBER (gpointer, vtable, plan->vfunc_offset);
+  if (address == NULL)
+    return peas_method_apply_plan (instance, plan, args, return_value);
+
+  if (return_value == NULL)
+    return_value = &dummy_return_value;
+
+  invoke_native (plan, address, instance, args, return_value);
+  return TRUE;
+}
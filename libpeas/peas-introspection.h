@@ -27,6 +27,43 @@
 
 G_BEGIN_DECLS
 
+typedef struct _PeasCallPlan PeasCallPlan;
+
+/* What is needed to call a method, computed once by peas_gi_get_call_plan() */
+struct _PeasCallPlan {
+  GType iface_type;
+  const gchar *method_name; /* interned */
+  GICallableInfo *callable_info;
+
+  guint n_args;
+  GIDirection *directions;
+  GITypeTag *tags;
+
+  /* The indexes of the arguments passed in and out of the method,
+   * inout arguments being in both */
+  guint n_in_args;
+  guint *in_indexes;
+  guint n_out_args;
+  guint *out_indexes;
+
+  GITypeInfo *return_type_info;
+  GITypeTag return_tag;
+  /* Whether the return value is an enum or flags, which are
+   * returned as integers */
+  gboolean return_is_enum;
+
+  /* A prepared GIFunctionInvoker, or NULL if the method must be called
+   * with g_function_info_invoke() */
+  gpointer invoker;
+
+  /* The offset of the vfunc wrapped by the method in the class or
+   * interface structure, or -1 if it must be called through the invoker */
+  gint vfunc_offset;
+};
+
+const PeasCallPlan *
+                 peas_gi_get_call_plan            (GType        iface_type,
+                                                   const gchar *method_name);
 GICallableInfo  *peas_gi_get_method_info          (GType        iface_type,
                                                    const gchar *method_name);
 
@@ -34,6 +71,11 @@ void             peas_gi_valist_to_arguments      (GICallableInfo *callable_info
                                                    va_list         va_args,
                                                    GIArgument     *arguments,
                                                    gpointer       *return_value);
+void             peas_gi_call_plan_valist_to_arguments
+                                                  (const PeasCallPlan *plan,
+                                                   va_list             va_args,
+                                                   GIArgument         *arguments,
+                                                   gpointer           *return_value);
 void             peas_gi_argument_to_pointer      (GITypeInfo     *type_info,
                                                    GIArgument     *arg,
                                                    gpointer        ptr);
@@ -45,6 +87,18 @@ gboolean         peas_method_apply                (GObject     *instance,
                                                    const gchar *method_name,
                                                    GIArgument  *args,
                                                    GIArgument  *return_value);
+gboolean         peas_method_apply_plan           (GObject            *instance,
+                                                   const PeasCallPlan *plan,
+                                                   GIArgument         *args,
+                                                   GIArgument         *return_value);
+
+gpointer         peas_gi_get_vtable               (GObject            *instance,
+                                                   GType               iface_type);
+gboolean         peas_method_apply_vfunc          (GObject            *instance,
+                                                   gpointer            vtable,
+                                                   const PeasCallPlan *plan,
+                                                   GIArgument         *args,
+                                                   GIArgument         *return_value);
 
 G_END_DECLS
 
@@ -0,0 +1,36 @@
+/*
+ * peas-method-priv.h
+ * This file is part of libpeas
+ *
+ * Copyright (C) 2026 - agent
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Library General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __PEAS_METHOD_PRIV_H__
+#define __PEAS_METHOD_PRIV_H__
+
+#include "peas-method.h"
+#include "peas-introspection.h"
+
+struct _PeasMethod {
+  /*< private >*/
+  gint refcount;
+
+  /* Shared with all the other handles on the same method */
+  const PeasCallPlan *plan;
+};
+
+#endif /* __PEAS_METHOD_PRIV_H__ */
@@ -0,0 +1,160 @@
+/*
+ * peas-method.c
+ * This file is part of libpeas
+ *
+ * Copyright (C) 2026 - agent
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Library General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "peas-method-priv.h"
+
+/**
+ * SECTION:peas-method
+ * @short_description: Resolved method of an extension type.
+ * @see_also: #PeasExtension, #PeasExtensionSet
+ *
+ * A #PeasMethod is a handle on a method of an extension type, which is
+ * looked up in the introspection data once when the handle is created.
+ *
+ * Calling a method through peas_extension_call_method() or
+ * peas_extension_set_call_method() rather than peas_extension_call()
+ * avoids looking the method up by name on every call, which is worth it
+ * for methods called very often:
+ *
+ * |[
+ * static PeasMethod *update_method = NULL;
+ *
+ * if (update_method == NULL)
+ *   update_method = peas_method_new (MY_TYPE_FRAME_HOOK, "update");
+ *
+ * peas_extension_set_call_method (set, update_method, frame_time);
+ * ]|
+ **/
+
+GType
+peas_method_get_type (void)
+{
+  static GType the_type = 0;
+
+  if (G_UNLIKELY (!the_type))
+    the_type = g_boxed_type_register_static (g_intern_static_string ("PeasMethod"),
+                                             (GBoxedCopyFunc) peas_method_ref,
+                                             (GBoxedFreeFunc) peas_method_unref);
+
+  return the_type;
+}
+
+/**
+ * peas_method_new:
+ * @exten_type: the #GType of the extension interface or class.
+ * @method_name: the name of the method.
+ *
+ * Looks up the method @method_name of @exten_type.
+ *
+ * As for peas_extension_call(), the introspection data for @exten_type
+ * must have been loaded previously through g_irepository_require().
+ *
+ * Return value: a new #PeasMethod, or %NULL if the method was not found.
+ */
+PeasMethod *
+peas_method_new (GType        exten_type,
+                 const gchar *method_name)
+{
+  const PeasCallPlan *plan;
+  PeasMethod *method;
+
+  g_return_val_if_fail (exten_type != G_TYPE_INVALID, NULL);
+  g_return_val_if_fail (method_name != NULL, NULL);
+
+  plan = peas_gi_get_call_plan (exten_type, method_name);
+  if (plan == NULL)
+    return NULL;
+
+  method = g_slice_new (PeasMethod);
+  method->refcount = 1;
+  method->plan = plan;
+
+  return method;
+}
+
+/**
+ * peas_method_ref:
+ * @method: A #PeasMethod.
+ *
+ * Increases the reference count of @method.
+ *
+ * Return value: @method.
+ */
+PeasMethod *
+peas_method_ref (PeasMethod *method)
+{
+  g_return_val_if_fail (method != NULL, NULL);
+
+  g_atomic_int_inc (&method->refcount);
+  return method;
+}
+
+/**
+ * peas_method_unref:
+ * @method: A #PeasMethod.
+ *
+ * Decreases the reference count of @method, freeing it when it drops
+ * to zero.
+ */
+void
+peas_method_unref (PeasMethod *method)
+{
+  g_return_if_fail (method != NULL);
+
+  if (g_atomic_int_dec_and_test (&method->refcount))
+    g_slice_free (PeasMethod, method);
+}
+
+/**
+ * peas_method_get_extension_type:
+ * @method: A #PeasMethod.
+ *
+ * Gets the type of the extension interface or class @method belongs to.
+ *
+ * Return value: the #GType @method was resolved from.
+ */
+GType
+peas_method_get_extension_type (PeasMethod *method)
+{
+  g_return_val_if_fail (method != NULL, G_TYPE_INVALID);
+
+  return method->plan->iface_type;
+}
+
+/**
+ * peas_method_get_name:
+ * @method: A #PeasMethod.
+ *
+ * Gets the name of @method.
+ *
+ * Return value: the name of the method.
+ */
+const gchar *
+peas_method_get_name (PeasMethod *method)
+{
+  g_return_val_if_fail (method != NULL, NULL);
+
+  return method->plan->method_name;
+}
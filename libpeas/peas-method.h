@@ -0,0 +1,52 @@
+/*
+ * peas-method.h
+ * This file is part of libpeas
+ *
+ * Copyright (C) 2026 - agent
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Library General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __PEAS_METHOD_H__
+#define __PEAS_METHOD_H__
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define PEAS_TYPE_METHOD   (peas_method_get_type ())
+#define PEAS_METHOD(obj)   ((PeasMethod *) (obj))
+
+/**
+ * PeasMethod:
+ *
+ * The #PeasMethod structure contains only private data and should only
+ * be accessed using the provided API.
+ */
+typedef struct _PeasMethod PeasMethod;
+
+GType         peas_method_get_type            (void) G_GNUC_CONST;
+
+PeasMethod   *peas_method_new                 (GType        exten_type,
+                                               const gchar *method_name);
+PeasMethod   *peas_method_ref                 (PeasMethod  *method);
+void          peas_method_unref               (PeasMethod  *method);
+
+GType         peas_method_get_extension_type  (PeasMethod  *method);
+const gchar  *peas_method_get_name            (PeasMethod  *method);
+
+G_END_DECLS
+
+#endif /* __PEAS_METHOD_H__ */
@@ -30,6 +30,7 @@
 #include <string.h>
 
 #include "peas-object-module.h"
+#include "peas-trace.h"
 
 /**
  * SECTION:peas-object-module
@@ -77,13 +78,14 @@ peas_object_module_register_types (PeasObjectModule *module)
   g_return_if_fail (PEAS_IS_OBJECT_MODULE (module));
   g_return_if_fail (module->priv->register_func != NULL);
 
+  PEAS_TRACE_BEGIN ("register_types", module->priv->module_name);
   module->priv->register_func (module);
+  PEAS_TRACE_END ("register_types", module->priv->module_name);
 }
 
 static gboolean
-peas_object_module_load (GTypeModule *gmodule)
+load_library (PeasObjectModule *module)
 {
-  PeasObjectModule *module = PEAS_OBJECT_MODULE (gmodule);
   gchar *path;
 
   path = g_module_build_path (module->priv->path, module->priv->module_name);
@@ -137,6 +139,19 @@ peas_object_module_load (GTypeModule *gmodule)
   return TRUE;
 }
 
+static gboolean
+peas_object_module_load (GTypeModule *gmodule)
+{
+  PeasObjectModule *module = PEAS_OBJECT_MODULE (gmodule);
+  gboolean loaded;
+
+  PEAS_TRACE_BEGIN ("peas_object_module_load", module->priv->module_name);
+  loaded = load_library (module);
+  PEAS_TRACE_END ("peas_object_module_load", module->priv->module_name);
+
+  return loaded;
+}
+
 static void
 peas_object_module_unload (GTypeModule *gmodule)
 {
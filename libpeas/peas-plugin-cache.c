@@ -0,0 +1,735 @@
+/*
+ * peas-plugin-cache.c
+ * This file is part of libpeas
+ *
+ * Copyright (C) 2026 - agent
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Library General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <errno.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include <glib/gstdio.h>
+
+#include "peas-dirs.h"
+#include "peas-plugin-cache.h"
+#include "peas-plugin-info-priv.h"
+
+/*
+ * The plugin cache stores the parsed contents of the plugin info files
+ * found in a search path, so they do not need to be parsed again the next
+ * time the search path is scanned. There is one cache file per search path,
+ * stored in the user cache directory (or PEAS_PLUGIN_CACHE_DIR if set, an
+ * empty value disabling the cache altogether).
+ *
+ * The cache is a serialized GVariant which is mapped into memory. Every
+ * directory record stores the mtime of the directory, and every plugin
+ * entry the mtime, inode and size of the plugin info file, so changes are
+ * detected with a stat() call and only the modified files are parsed.
+ * Files whose mtime is not older than the creation of the cache are never
+ * trusted, as they could have been modified in the same second.
+ *
+ * Plugin info files which failed to parse are recorded without information,
+ * and parsed again on every scan so the warnings are not lost.
+ *
+ * The cache version must be bumped whenever the format changes, including
+ * PEAS_PLUGIN_INFO_VARIANT_TYPE.
+ */
+
+#define CACHE_VERSION 4
+
+/* (filename, mtime, inode, size, info) */
+#define CACHE_ENTRY_TYPE  "(sxttm" PEAS_PLUGIN_INFO_VARIANT_TYPE ")"
+/* (path, mtime, subdirs listed, entries, subdirs) */
+#define CACHE_DIR_TYPE    "(sxba" CACHE_ENTRY_TYPE "as)"
+/* (version, timestamp, locales, directories) */
+#define CACHE_TYPE        "(uxsa" CACHE_DIR_TYPE ")"
+
+struct _PeasPluginCache {
+  gchar *filename;
+  gchar *locales;
+
+  /* Time of the last scan, and of the current one */
+  gint64 timestamp;
+  gint64 scan_time;
+
+  /* Directory path -> directory record */
+  GHashTable *old_dirs;
+  /* The directory records for the next cache */
+  GPtrArray *new_dirs;
+
+  guint dirty : 1;
+};
+
+struct _PeasPluginCacheDir {
+  gchar *module_dir;
+  gchar *data_dir;
+  gint64 mtime;
+
+  guint list_subdirs : 1;
+  guint listed_subdirs : 1;
+  guint changed : 1;
+
+  /* One item per plugin info file */
+  GPtrArray *basenames;
+  GPtrArray *old_entries;
+  GPtrArray *new_entries;
+  GPtrArray *infos;
+
+  GPtrArray *subdirs;
+};
+
+static gchar *
+get_locales (void)
+{
+  return g_strjoinv (":", (gchar **) g_get_language_names ());
+}
+
+static void
+load_cache_file (PeasPluginCache *cache)
+{
+  GMappedFile *mapped;
+  GVariant *contents;
+  GVariant *dirs;
+  GVariant *dir;
+  GVariantIter iter;
+  guint32 version;
+  const gchar *locales;
+
+  mapped = g_mapped_file_new (cache->filename, FALSE, NULL);
+  if (mapped == NULL)
+    return;
+
+  if (g_mapped_file_get_length (mapped) == 0)
+    {
+      g_mapped_file_unref (mapped);
+      return;
+    }
+
+  /* The cache is not trusted, it is validated by GVariant */
+  contents = g_variant_new_from_data (G_VARIANT_TYPE (CACHE_TYPE),
+                                      g_mapped_file_get_contents (mapped),
+                                      g_mapped_file_get_length (mapped),
+                                      FALSE,
+                                      (GDestroyNotify) g_mapped_file_unref,
+                                      mapped);
+  g_variant_ref_sink (contents);
+
+  g_variant_get (contents, "(ux&s@a" CACHE_DIR_TYPE ")",
+                 &version, &cache->timestamp, &locales, &dirs);
+
+  if (version != CACHE_VERSION || strcmp (locales, cache->locales) != 0)
+    {
+      g_debug ("Ignoring outdated plugin cache '%s'", cache->filename);
+      g_variant_unref (dirs);
+      g_variant_unref (contents);
+      return;
+    }
+
+  g_variant_iter_init (&iter, dirs);
+  while ((dir = g_variant_iter_next_value (&iter)) != NULL)
+    {
+      gchar *path;
+
+      g_variant_get_child (dir, 0, "s", &path);
+      g_hash_table_insert (cache->old_dirs, path, dir);
+    }
+
+  g_variant_unref (dirs);
+  g_variant_unref (contents);
+}
+
+/*
+ * _peas_plugin_cache_new:
+ * @search_path: The module directory of a search path.
+ *
+ * Opens the plugin cache of @search_path. If there is no valid cache,
+ * an empty one is returned and every plugin file will be parsed.
+ *
+ * Return value: a new #PeasPluginCache.
+ */
+PeasPluginCache *
+_peas_plugin_cache_new (const gchar *search_path)
+{
+  PeasPluginCache *cache;
+  gchar *cache_dir;
+  gchar *checksum;
+  gchar *basename;
+
+  g_return_val_if_fail (search_path != NULL, NULL);
+
+  cache = g_slice_new0 (PeasPluginCache);
+  cache->scan_time = time (NULL);
+  cache->old_dirs = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                           (GDestroyNotify) g_variant_unref);
+  cache->new_dirs = g_ptr_array_new_with_free_func ((GDestroyNotify) g_variant_unref);
+
+  cache_dir = peas_dirs_get_plugin_cache_dir ();
+  if (cache_dir == NULL)
+    return cache;
+
+  checksum = g_compute_checksum_for_string (G_CHECKSUM_MD5, search_path, -1);
+  basename = g_strconcat (checksum, ".cache", NULL);
+  cache->filename = g_build_filename (cache_dir, basename, NULL);
+  cache->locales = get_locales ();
+
+  g_free (basename);
+  g_free (checksum);
+  g_free (cache_dir);
+
+  load_cache_file (cache);
+
+  return cache;
+}
+
+/*
+ * _peas_plugin_cache_free:
+ * @cache: A #PeasPluginCache.
+ *
+ * Frees @cache, without saving it.
+ */
+void
+_peas_plugin_cache_free (PeasPluginCache *cache)
+{
+  g_return_if_fail (cache != NULL);
+
+  g_hash_table_destroy (cache->old_dirs);
+  g_ptr_array_free (cache->new_dirs, TRUE);
+  g_free (cache->locales);
+  g_free (cache->filename);
+
+  g_slice_free (PeasPluginCache, cache);
+}
+
+/*
+ * _peas_plugin_cache_save:
+ * @cache: A #PeasPluginCache.
+ *
+ * Writes the directories read from @cache back to the cache file, if
+ * anything changed since the cache was written.
+ */
+void
+_peas_plugin_cache_save (PeasPluginCache *cache)
+{
+  GVariantBuilder dirs;
+  GVariant *contents;
+  gchar *dirname;
+  guint i;
+  GError *error = NULL;
+
+  g_return_if_fail (cache != NULL);
+
+  if (cache->filename == NULL)
+    return;
+
+  if (!cache->dirty && cache->new_dirs->len == g_hash_table_size (cache->old_dirs))
+    return;
+
+  g_variant_builder_init (&dirs, G_VARIANT_TYPE ("a" CACHE_DIR_TYPE));
+  for (i = 0; i < cache->new_dirs->len; i++)
+    g_variant_builder_add_value (&dirs, g_ptr_array_index (cache->new_dirs, i));
+
+  contents = g_variant_new ("(uxs@a" CACHE_DIR_TYPE ")",
+                            (guint32) CACHE_VERSION, cache->scan_time,
+                            cache->locales, g_variant_builder_end (&dirs));
+  g_variant_ref_sink (contents);
+
+  dirname = g_path_get_dirname (cache->filename);
+  g_mkdir_with_parents (dirname, 0755);
+
+  if (!g_file_set_contents (cache->filename,
+                            g_variant_get_data (contents),
+                            g_variant_get_size (contents),
+                            &error))
+    {
+      g_debug ("Could not write the plugin cache: %s", error->message);
+      g_error_free (error);
+    }
+  else
+    {
+      cache->dirty = FALSE;
+    }
+
+  g_free (dirname);
+  g_variant_unref (contents);
+}
+
+static gboolean
+is_trusted (PeasPluginCache *cache,
+            gint64           mtime)
+{
+  return mtime < cache->timestamp;
+}
+
+static void
+unref_variants (GPtrArray *variants)
+{
+  guint i;
+
+  for (i = 0; i < variants->len; i++)
+    {
+      if (g_ptr_array_index (variants, i) != NULL)
+        g_variant_unref (g_ptr_array_index (variants, i));
+    }
+
+  g_ptr_array_free (variants, TRUE);
+}
+
+static void
+cache_dir_free (PeasPluginCacheDir *dir)
+{
+  if (dir->infos != NULL)
+    {
+      guint i;
+
+      for (i = 0; i < dir->infos->len; i++)
+        {
+          if (g_ptr_array_index (dir->infos, i) != NULL)
+            _peas_plugin_info_unref (g_ptr_array_index (dir->infos, i));
+        }
+
+      g_ptr_array_free (dir->infos, TRUE);
+    }
+
+  if (dir->new_entries != NULL)
+    unref_variants (dir->new_entries);
+
+  unref_variants (dir->old_entries);
+  g_ptr_array_free (dir->basenames, TRUE);
+  g_ptr_array_free (dir->subdirs, TRUE);
+  g_free (dir->module_dir);
+  g_free (dir->data_dir);
+
+  g_slice_free (PeasPluginCacheDir, dir);
+}
+
+/* Returns the plugin info for @basename, from the cache if @old_entry is
+ * still valid. @new_entry is set to the entry for the next cache, or NULL
+ * if the file could not be stat()ed. This is called from the scanning
+ * threads, so it must not modify @cache. */
+static PeasPluginInfo *
+load_entry (PeasPluginCache *cache,
+            const gchar     *module_dir,
+            const gchar     *data_dir,
+            const gchar     *basename,
+            GVariant        *old_entry,
+            GVariant       **new_entry)
+{
+  PeasPluginInfo *info = NULL;
+  gchar *filename;
+  struct stat buf;
+
+  filename = g_build_filename (module_dir, basename, NULL);
+  *new_entry = NULL;
+
+  if (g_stat (filename, &buf) != 0)
+    {
+      info = _peas_plugin_info_new (filename, module_dir, data_dir);
+      goto out;
+    }
+
+  if (old_entry != NULL)
+    {
+      gint64 mtime;
+      guint64 inode, size;
+      GVariant *maybe_info;
+      GVariant *info_variant;
+
+      g_variant_get (old_entry, "(&sxtt@m" PEAS_PLUGIN_INFO_VARIANT_TYPE ")",
+                     NULL, &mtime, &inode, &size, &maybe_info);
+      info_variant = g_variant_get_maybe (maybe_info);
+      g_variant_unref (maybe_info);
+
+      if (info_variant != NULL &&
+          is_trusted (cache, mtime) &&
+          mtime == (gint64) buf.st_mtime &&
+          inode == (guint64) buf.st_ino &&
+          size == (guint64) buf.st_size)
+        {
+          info = _peas_plugin_info_new_from_variant (filename, module_dir,
+                                                     data_dir, info_variant);
+        }
+
+      if (info_variant != NULL)
+        g_variant_unref (info_variant);
+
+      if (info != NULL)
+        {
+          *new_entry = g_variant_ref (old_entry);
+          goto out;
+        }
+    }
+
+  info = _peas_plugin_info_new (filename, module_dir, data_dir);
+
+  *new_entry = g_variant_new ("(sxtt@m" PEAS_PLUGIN_INFO_VARIANT_TYPE ")",
+                              basename, (gint64) buf.st_mtime,
+                              (guint64) buf.st_ino, (guint64) buf.st_size,
+                              g_variant_new_maybe (G_VARIANT_TYPE (PEAS_PLUGIN_INFO_VARIANT_TYPE),
+                                                   info != NULL ? _peas_plugin_info_to_variant (info) : NULL));
+  g_variant_ref_sink (*new_entry);
+
+out:
+  if (info == NULL)
+    g_warning ("Error loading '%s'", filename);
+
+  g_free (filename);
+
+  return info;
+}
+
+/*
+ * _peas_plugin_cache_open_dir:
+ * @cache: A #PeasPluginCache.
+ * @module_dir: The directory to read.
+ * @data_dir: The data directory of the search path.
+ * @list_subdirs: Whether the subdirectories of @module_dir are needed.
+ *
+ * Lists the plugin info files and the subdirectories of @module_dir,
+ * using the cache when the directory did not change since the last scan.
+ * The plugin info files are not loaded yet, see
+ * _peas_plugin_cache_dir_load_file().
+ *
+ * This only reads @cache, so several directories can be opened and loaded
+ * concurrently, but they must be closed from a single thread.
+ *
+ * Return value: a new #PeasPluginCacheDir, or %NULL if @module_dir could
+ * not be read.
+ */
+PeasPluginCacheDir *
+_peas_plugin_cache_open_dir (PeasPluginCache *cache,
+                             const gchar     *module_dir,
+                             const gchar     *data_dir,
+                             gboolean         list_subdirs)
+{
+  PeasPluginCacheDir *dir;
+  GVariant *record;
+  GVariant *old_entries = NULL;
+  GVariant *old_subdirs = NULL;
+  struct stat buf;
+  gint64 mtime;
+  gboolean listed_subdirs = FALSE;
+  gboolean dir_valid = FALSE;
+
+  g_return_val_if_fail (cache != NULL, NULL);
+  g_return_val_if_fail (module_dir != NULL, NULL);
+
+  if (g_stat (module_dir, &buf) != 0)
+    {
+      g_debug ("Could not open '%s': %s", module_dir, g_strerror (errno));
+      return NULL;
+    }
+
+  dir = g_slice_new0 (PeasPluginCacheDir);
+  dir->module_dir = g_strdup (module_dir);
+  dir->data_dir = g_strdup (data_dir);
+  dir->mtime = buf.st_mtime;
+  dir->list_subdirs = list_subdirs;
+  dir->basenames = g_ptr_array_new_with_free_func (g_free);
+  dir->old_entries = g_ptr_array_new ();
+  dir->subdirs = g_ptr_array_new_with_free_func (g_free);
+
+  record = g_hash_table_lookup (cache->old_dirs, module_dir);
+  if (record != NULL)
+    {
+      g_variant_get (record, "(&sxb@a" CACHE_ENTRY_TYPE "@as)",
+                     NULL, &mtime, &listed_subdirs,
+                     &old_entries, &old_subdirs);
+
+      dir_valid = is_trusted (cache, mtime) &&
+                  mtime == dir->mtime &&
+                  (listed_subdirs || !list_subdirs);
+    }
+
+  if (dir_valid)
+    {
+      GVariantIter iter;
+      GVariant *old_entry;
+      const gchar *subdir;
+
+      g_variant_iter_init (&iter, old_entries);
+      while ((old_entry = g_variant_iter_next_value (&iter)) != NULL)
+        {
+          const gchar *basename;
+
+          g_variant_get_child (old_entry, 0, "&s", &basename);
+
+          g_ptr_array_add (dir->basenames, g_strdup (basename));
+          g_ptr_array_add (dir->old_entries, old_entry);
+        }
+
+      g_variant_iter_init (&iter, old_subdirs);
+      while (g_variant_iter_next (&iter, "&s", &subdir))
+        g_ptr_array_add (dir->subdirs, g_strdup (subdir));
+
+      dir->listed_subdirs = listed_subdirs;
+    }
+  else
+    {
+      GDir *d;
+      const gchar *dirent;
+      GHashTable *old_entry_names = NULL;
+      GError *error = NULL;
+
+      d = g_dir_open (module_dir, 0, &error);
+
+      if (!d)
+        {
+          g_debug ("%s", error->message);
+          g_error_free (error);
+          cache_dir_free (dir);
+          dir = NULL;
+          goto out;
+        }
+
+      /* Maps the file names to their index in the old entries */
+      if (old_entries != NULL)
+        {
+          gsize i, n_entries;
+
+          old_entry_names = g_hash_table_new (g_str_hash, g_str_equal);
+          n_entries = g_variant_n_children (old_entries);
+
+          for (i = 0; i < n_entries; i++)
+            {
+              const gchar *basename;
+
+              g_variant_get_child (old_entries, i, "(&sxtt@m"
+                                   PEAS_PLUGIN_INFO_VARIANT_TYPE ")",
+                                   &basename, NULL, NULL, NULL, NULL);
+              g_hash_table_insert (old_entry_names, (gpointer) basename,
+                                   GSIZE_TO_POINTER (i + 1));
+            }
+        }
+
+      while ((dirent = g_dir_read_name (d)))
+        {
+          if (g_str_has_suffix (dirent, ".plugin"))
+            {
+              GVariant *old_entry = NULL;
+              gsize index = 0;
+
+              if (old_entry_names != NULL)
+                index = GPOINTER_TO_SIZE (g_hash_table_lookup (old_entry_names,
+                                                               dirent));
+
+              if (index > 0)
+                old_entry = g_variant_get_child_value (old_entries, index - 1);
+
+              g_ptr_array_add (dir->basenames, g_strdup (dirent));
+              g_ptr_array_add (dir->old_entries, old_entry);
+            }
+          else if (list_subdirs)
+            {
+              gchar *filename;
+
+              filename = g_build_filename (module_dir, dirent, NULL);
+
+              if (g_file_test (filename, G_FILE_TEST_IS_DIR))
+                g_ptr_array_add (dir->subdirs, g_strdup (dirent));
+
+              g_free (filename);
+            }
+        }
+
+      if (old_entry_names != NULL)
+        g_hash_table_destroy (old_entry_names);
+
+      g_dir_close (d);
+
+      dir->listed_subdirs = list_subdirs;
+      dir->changed = TRUE;
+    }
+
+  dir->new_entries = g_ptr_array_sized_new (dir->basenames->len);
+  g_ptr_array_set_size (dir->new_entries, dir->basenames->len);
+  dir->infos = g_ptr_array_sized_new (dir->basenames->len);
+  g_ptr_array_set_size (dir->infos, dir->basenames->len);
+
+out:
+  if (old_entries != NULL)
+    g_variant_unref (old_entries);
+  if (old_subdirs != NULL)
+    g_variant_unref (old_subdirs);
+
+  return dir;
+}
+
+/*
+ * _peas_plugin_cache_dir_get_n_files:
+ * @dir: A #PeasPluginCacheDir.
+ *
+ * Return value: the number of plugin info files in @dir.
+ */
+guint
+_peas_plugin_cache_dir_get_n_files (PeasPluginCacheDir *dir)
+{
+  g_return_val_if_fail (dir != NULL, 0);
+
+  return dir->basenames->len;
+}
+
+/*
+ * _peas_plugin_cache_dir_get_subdirs:
+ * @dir: A #PeasPluginCacheDir.
+ * @subdirs: A #GPtrArray the subdirectory paths are appended to.
+ *   They must be freed with g_free().
+ *
+ * Gets the subdirectories of @dir, if they were requested when opening it.
+ */
+void
+_peas_plugin_cache_dir_get_subdirs (PeasPluginCacheDir *dir,
+                                    GPtrArray          *subdirs)
+{
+  guint i;
+
+  g_return_if_fail (dir != NULL);
+  g_return_if_fail (subdirs != NULL);
+
+  if (!dir->list_subdirs)
+    return;
+
+  for (i = 0; i < dir->subdirs->len; i++)
+    g_ptr_array_add (subdirs, g_build_filename (dir->module_dir,
+                                                g_ptr_array_index (dir->subdirs, i),
+                                                NULL));
+}
+
+/*
+ * _peas_plugin_cache_dir_load_file:
+ * @cache: The #PeasPluginCache @dir was opened from.
+ * @dir: A #PeasPluginCacheDir.
+ * @index: The index of the plugin info file to load.
+ *
+ * Loads a plugin info file of @dir, from the cache if it did not change.
+ * Different files of the same directory can be loaded concurrently.
+ */
+void
+_peas_plugin_cache_dir_load_file (PeasPluginCache    *cache,
+                                  PeasPluginCacheDir *dir,
+                                  guint               index)
+{
+  GVariant *new_entry;
+
+  g_return_if_fail (cache != NULL);
+  g_return_if_fail (dir != NULL);
+  g_return_if_fail (index < dir->basenames->len);
+
+  g_ptr_array_index (dir->infos, index) =
+      load_entry (cache, dir->module_dir, dir->data_dir,
+                  g_ptr_array_index (dir->basenames, index),
+                  g_ptr_array_index (dir->old_entries, index),
+                  &new_entry);
+  g_ptr_array_index (dir->new_entries, index) = new_entry;
+}
+
+/*
+ * _peas_plugin_cache_close_dir:
+ * @cache: The #PeasPluginCache @dir was opened from.
+ * @dir: A #PeasPluginCacheDir, which is freed.
+ * @infos: A #GPtrArray the #PeasPluginInfo<!-- -->s loaded from @dir
+ *   are appended to, in the directory order.
+ *
+ * Records @dir in the next version of @cache and frees it.
+ */
+void
+_peas_plugin_cache_close_dir (PeasPluginCache    *cache,
+                              PeasPluginCacheDir *dir,
+                              GPtrArray          *infos)
+{
+  GVariantBuilder entries;
+  GVariant *record;
+  guint i;
+
+  g_return_if_fail (cache != NULL);
+  g_return_if_fail (dir != NULL);
+  g_return_if_fail (infos != NULL);
+
+  g_variant_builder_init (&entries, G_VARIANT_TYPE ("a" CACHE_ENTRY_TYPE));
+
+  for (i = 0; i < dir->basenames->len; i++)
+    {
+      PeasPluginInfo *info = g_ptr_array_index (dir->infos, i);
+      GVariant *new_entry = g_ptr_array_index (dir->new_entries, i);
+
+      if (info != NULL)
+        g_ptr_array_add (infos, info);
+
+      if (new_entry != g_ptr_array_index (dir->old_entries, i))
+        dir->changed = TRUE;
+
+      if (new_entry != NULL)
+        g_variant_builder_add_value (&entries, new_entry);
+    }
+
+  /* The infos now belong to the caller */
+  g_ptr_array_set_size (dir->infos, 0);
+
+  record = g_variant_new ("(sxb@a" CACHE_ENTRY_TYPE "@as)",
+                          dir->module_dir, dir->mtime, dir->listed_subdirs,
+                          g_variant_builder_end (&entries),
+                          g_variant_new_strv ((const gchar * const *) dir->subdirs->pdata,
+                                              dir->subdirs->len));
+  g_ptr_array_add (cache->new_dirs, g_variant_ref_sink (record));
+
+  if (dir->changed)
+    cache->dirty = TRUE;
+
+  cache_dir_free (dir);
+}
+
+/*
+ * _peas_plugin_cache_read_dir:
+ * @cache: A #PeasPluginCache.
+ * @module_dir: The directory to read.
+ * @data_dir: The data directory of the search path.
+ * @list_subdirs: Whether the subdirectories of @module_dir are needed.
+ * @infos: A #GPtrArray the #PeasPluginInfo<!-- -->s found are appended to.
+ * @subdirs: A #GPtrArray the subdirectory paths are appended to,
+ *   if @list_subdirs is %TRUE. They must be freed with g_free().
+ *
+ * Reads the plugin info files of @module_dir, using the cache when the
+ * files did not change since the last scan.
+ */
+void
+_peas_plugin_cache_read_dir (PeasPluginCache *cache,
+                             const gchar     *module_dir,
+                             const gchar     *data_dir,
+                             gboolean         list_subdirs,
+                             GPtrArray       *infos,
+                             GPtrArray       *subdirs)
+{
+  PeasPluginCacheDir *dir;
+  guint i;
+
+  dir = _peas_plugin_cache_open_dir (cache, module_dir, data_dir, list_subdirs);
+  if (dir == NULL)
+    return;
+
+  for (i = 0; i < dir->basenames->len; i++)
+    _peas_plugin_cache_dir_load_file (cache, dir, i);
+
+  _peas_plugin_cache_dir_get_subdirs (dir, subdirs);
+  _peas_plugin_cache_close_dir (cache, dir, infos);
+}
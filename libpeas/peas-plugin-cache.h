@@ -0,0 +1,61 @@
+/*
+ * peas-plugin-cache.h
+ * This file is part of libpeas
+ *
+ * Copyright (C) 2026 - agent
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Library General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+
+
+#ifndef __PEAS_PLUGIN_CACHE_H__
+#define __PEAS_PLUGIN_CACHE_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _PeasPluginCache    PeasPluginCache;
+typedef struct _PeasPluginCacheDir PeasPluginCacheDir;
+
+PeasPluginCache    *_peas_plugin_cache_new             (const gchar        *search_path);
+void                _peas_plugin_cache_free            (PeasPluginCache    *cache);
+void                _peas_plugin_cache_save            (PeasPluginCache    *cache);
+
+void                _peas_plugin_cache_read_dir        (PeasPluginCache    *cache,
+                                                        const gchar        *module_dir,
+                                                        const gchar        *data_dir,
+                                                        gboolean            list_subdirs,
+                                                        GPtrArray          *infos,
+                                                        GPtrArray          *subdirs);
+
+PeasPluginCacheDir *_peas_plugin_cache_open_dir        (PeasPluginCache    *cache,
+                                                        const gchar        *module_dir,
+                                                        const gchar        *data_dir,
+                                                        gboolean            list_subdirs);
+guint               _peas_plugin_cache_dir_get_n_files (PeasPluginCacheDir *dir);
+void                _peas_plugin_cache_dir_get_subdirs (PeasPluginCacheDir *dir,
+                                                        GPtrArray          *subdirs);
+void                _peas_plugin_cache_dir_load_file   (PeasPluginCache    *cache,
+                                                        PeasPluginCacheDir *dir,
+                                                        guint               index);
+void                _peas_plugin_cache_close_dir       (PeasPluginCache    *cache,
+                                                        PeasPluginCacheDir *dir,
+                                                        GPtrArray          *infos);
+
+G_END_DECLS
+
+#endif /* __PEAS_PLUGIN_CACHE_H__ */
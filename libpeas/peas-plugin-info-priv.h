@@ -45,7 +45,9 @@ struct _PeasPluginInfo {
   gchar *website;
   gchar *version;
   gchar *help_uri;
+  gchar **extension_types;
   guint iage;
+  gint priority;
   GHashTable *keys;
 
   gint loaded : 1;
@@ -55,13 +57,28 @@ struct _PeasPluginInfo {
   gint available : 1;
 
   guint builtin : 1;
+  guint thread_safe : 1;
+  /* The plugin is loaded, but its loader was not asked to load it yet,
+     see peas_plugin_info_get_extension_types() */
+  guint deferred : 1;
 };
 
-PeasPluginInfo *_peas_plugin_info_new   (const gchar    *filename,
-                                         const gchar    *module_dir,
-                                         const gchar    *data_dir);
-PeasPluginInfo *_peas_plugin_info_ref   (PeasPluginInfo *info);
-void            _peas_plugin_info_unref (PeasPluginInfo *info);
+/* The serialized form of a PeasPluginInfo, see _peas_plugin_info_to_variant().
+ * Changing it requires bumping the plugin cache version. */
+#define PEAS_PLUGIN_INFO_VARIANT_TYPE       "(ssassmsmsmasmsmsmsmsmasuibba{sv})"
+#define PEAS_PLUGIN_INFO_VARIANT_FORMAT_NEW "(ss@assmsms@masmsmsmsms@masuibb@a{sv})"
+#define PEAS_PLUGIN_INFO_VARIANT_FORMAT_GET "(ss^assmsms@masmsmsmsms@masuibb@a{sv})"
+
+PeasPluginInfo *_peas_plugin_info_new              (const gchar          *filename,
+                                                    const gchar          *module_dir,
+                                                    const gchar          *data_dir);
+PeasPluginInfo *_peas_plugin_info_new_from_variant (const gchar          *filename,
+                                                    const gchar          *module_dir,
+                                                    const gchar          *data_dir,
+                                                    GVariant             *variant);
+GVariant       *_peas_plugin_info_to_variant       (const PeasPluginInfo *info);
+PeasPluginInfo *_peas_plugin_info_ref              (PeasPluginInfo       *info);
+void            _peas_plugin_info_unref            (PeasPluginInfo       *info);
 
 
 #endif /* __PEAS_PLUGIN_INFO_PRIV_H__ */
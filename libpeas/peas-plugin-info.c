@@ -29,6 +29,7 @@
 
 #include "peas-i18n.h"
 #include "peas-plugin-info-priv.h"
+#include "peas-trace.h"
 
 #ifdef G_OS_WIN32
 #define OS_HELP_KEY "Help-Windows"
@@ -89,6 +90,7 @@ _peas_plugin_info_unref (PeasPluginInfo *info)
   g_free (info->version);
   g_free (info->help_uri);
   g_strfreev (info->authors);
+  g_strfreev (info->extension_types);
 
   g_free (info);
 }
@@ -113,6 +115,21 @@ value_free (GValue *value)
   g_free (value);
 }
 
+static void
+add_extra_key (PeasPluginInfo *info,
+               const gchar    *key,
+               GValue         *value)
+{
+  if (info->keys == NULL)
+    {
+      info->keys = g_hash_table_new_full (g_str_hash,
+                                          g_str_equal,
+                                          g_free,
+                                          (GDestroyNotify) value_free);
+    }
+  g_hash_table_insert (info->keys, g_strdup (key), value);
+}
+
 static void
 parse_extra_keys (PeasPluginInfo   *info,
                   GKeyFile         *plugin_file,
@@ -140,7 +157,10 @@ parse_extra_keys (PeasPluginInfo   *info,
           g_str_equal (keys[i], "Website") ||
           g_str_equal (keys[i], "Version") ||
           g_str_has_prefix (keys[i], "Help") ||
-          g_str_equal (keys[i], "Builtin"))
+          g_str_equal (keys[i], "ExtensionTypes") ||
+          g_str_equal (keys[i], "Builtin") ||
+          g_str_equal (keys[i], "ThreadSafe") ||
+          g_str_equal (keys[i], "Priority"))
         continue;
 
       b = g_key_file_get_boolean (plugin_file, "Plugin", keys[i], &error);
@@ -167,14 +187,7 @@ parse_extra_keys (PeasPluginInfo   *info,
       if (!value)
         continue;
 
-      if (info->keys == NULL)
-        {
-          info->keys = g_hash_table_new_full (g_str_hash,
-                                              g_str_equal,
-                                              g_free,
-                                              (GDestroyNotify) value_free);
-        }
-      g_hash_table_insert (info->keys, g_strdup (keys[i]), value);
+      add_extra_key (info, keys[i], value);
     }
 }
 
@@ -203,6 +216,8 @@ _peas_plugin_info_new (const gchar *filename,
 
   g_return_val_if_fail (filename != NULL, NULL);
 
+  PEAS_TRACE_BEGIN ("_peas_plugin_info_new", filename);
+
   info = g_new0 (PeasPluginInfo, 1);
   info->refcount = 1;
   info->file = g_strdup (filename);
@@ -306,6 +321,11 @@ _peas_plugin_info_new (const gchar *filename,
         info->help_uri = str;
     }
 
+  /* Get the implemented extension types */
+  info->extension_types = g_key_file_get_string_list (plugin_file, "Plugin",
+                                                      "ExtensionTypes",
+                                                      NULL, NULL);
+
   /* Get Builtin */
   b = g_key_file_get_boolean (plugin_file, "Plugin", "Builtin", &error);
   if (error != NULL)
@@ -313,6 +333,20 @@ _peas_plugin_info_new (const gchar *filename,
   else
     info->builtin = b;
 
+  /* Get ThreadSafe */
+  b = g_key_file_get_boolean (plugin_file, "Plugin", "ThreadSafe", &error);
+  if (error != NULL)
+    g_clear_error (&error);
+  else
+    info->thread_safe = b;
+
+  /* Get Priority */
+  integer = g_key_file_get_integer (plugin_file, "Plugin", "Priority", &error);
+  if (error != NULL)
+    g_clear_error (&error);
+  else
+    info->priority = integer;
+
   /* Get extra keys */
   keys = g_key_file_get_keys (plugin_file, "Plugin", NULL, NULL);
   parse_extra_keys (info, plugin_file, (const gchar **) keys);
@@ -327,6 +361,8 @@ _peas_plugin_info_new (const gchar *filename,
      set it as available */
   info->available = TRUE;
 
+  PEAS_TRACE_END ("_peas_plugin_info_new", filename);
+
   return info;
 
 error:
@@ -337,9 +373,185 @@ error:
   g_free (info);
   g_key_file_free (plugin_file);
 
+  PEAS_TRACE_END ("_peas_plugin_info_new", filename);
+
   return NULL;
 }
 
+/*
+ * _peas_plugin_info_new_from_variant:
+ * @filename: The filename the plugin information was read from.
+ * @module_dir: The module directory.
+ * @data_dir: The data directory.
+ * @variant: A #GVariant of type %PEAS_PLUGIN_INFO_VARIANT_TYPE.
+ *
+ * Creates a new #PeasPluginInfo from information previously serialized by
+ * _peas_plugin_info_to_variant(), without touching the plugin file.
+ *
+ * Return value: a newly created #PeasPluginInfo, or %NULL if @variant does
+ * not hold valid plugin information.
+ */
+PeasPluginInfo *
+_peas_plugin_info_new_from_variant (const gchar *filename,
+                                    const gchar *module_dir,
+                                    const gchar *data_dir,
+                                    GVariant    *variant)
+{
+  PeasPluginInfo *info;
+  GVariant *authors;
+  GVariant *authors_list;
+  GVariant *extension_types;
+  GVariant *extension_types_list;
+  GVariant *keys;
+  GVariantIter iter;
+  gchar *key;
+  GVariant *key_value;
+  gboolean builtin;
+  gboolean thread_safe;
+
+  g_return_val_if_fail (filename != NULL, NULL);
+  g_return_val_if_fail (variant != NULL, NULL);
+
+  if (!g_variant_is_of_type (variant,
+                             G_VARIANT_TYPE (PEAS_PLUGIN_INFO_VARIANT_TYPE)))
+    return NULL;
+
+  info = g_new0 (PeasPluginInfo, 1);
+  info->refcount = 1;
+
+  g_variant_get (variant, PEAS_PLUGIN_INFO_VARIANT_FORMAT_GET,
+                 &info->module_name, &info->loader, &info->dependencies,
+                 &info->name, &info->desc, &info->icon_name, &authors,
+                 &info->copyright, &info->website, &info->version,
+                 &info->help_uri, &extension_types, &info->iage,
+                 &info->priority, &builtin, &thread_safe, &keys);
+
+  /* A corrupted cache is turned into default values by GVariant,
+     which are not valid plugin information */
+  if (*info->module_name == '\0' || *info->loader == '\0')
+    {
+      g_variant_unref (authors);
+      g_variant_unref (extension_types);
+      g_variant_unref (keys);
+      _peas_plugin_info_unref (info);
+      return NULL;
+    }
+
+  authors_list = g_variant_get_maybe (authors);
+  if (authors_list != NULL)
+    {
+      info->authors = g_variant_dup_strv (authors_list, NULL);
+      g_variant_unref (authors_list);
+    }
+  g_variant_unref (authors);
+
+  extension_types_list = g_variant_get_maybe (extension_types);
+  if (extension_types_list != NULL)
+    {
+      info->extension_types = g_variant_dup_strv (extension_types_list, NULL);
+      g_variant_unref (extension_types_list);
+    }
+  g_variant_unref (extension_types);
+
+  info->builtin = builtin;
+  info->thread_safe = thread_safe;
+
+  g_variant_iter_init (&iter, keys);
+  while (g_variant_iter_next (&iter, "{sv}", &key, &key_value))
+    {
+      GValue *value = NULL;
+
+      if (g_variant_is_of_type (key_value, G_VARIANT_TYPE_BOOLEAN))
+        {
+          value = g_new0 (GValue, 1);
+          g_value_init (value, G_TYPE_BOOLEAN);
+          g_value_set_boolean (value, g_variant_get_boolean (key_value));
+        }
+      else if (g_variant_is_of_type (key_value, G_VARIANT_TYPE_STRING))
+        {
+          value = g_new0 (GValue, 1);
+          g_value_init (value, G_TYPE_STRING);
+          g_value_set_string (value, g_variant_get_string (key_value, NULL));
+        }
+
+      if (value != NULL)
+        add_extra_key (info, key, value);
+
+      g_variant_unref (key_value);
+      g_free (key);
+    }
+  g_variant_unref (keys);
+
+  info->file = g_strdup (filename);
+  info->module_dir = g_strdup (module_dir);
+  info->data_dir = g_build_filename (data_dir, info->module_name, NULL);
+  info->available = TRUE;
+
+  return info;
+}
+
+/*
+ * _peas_plugin_info_to_variant:
+ * @info: A #PeasPluginInfo.
+ *
+ * Serializes the information read from the plugin file, so it can be
+ * restored later using _peas_plugin_info_new_from_variant(). The file and
+ * directory names and the loaded state are not part of the result.
+ *
+ * Return value: a floating #GVariant of type %PEAS_PLUGIN_INFO_VARIANT_TYPE.
+ */
+GVariant *
+_peas_plugin_info_to_variant (const PeasPluginInfo *info)
+{
+  GVariantBuilder keys;
+  GVariant *authors = NULL;
+  GVariant *extension_types = NULL;
+
+  g_return_val_if_fail (info != NULL, NULL);
+
+  g_variant_builder_init (&keys, G_VARIANT_TYPE ("a{sv}"));
+
+  if (info->keys != NULL)
+    {
+      GHashTableIter iter;
+      const gchar *key;
+      const GValue *value;
+
+      g_hash_table_iter_init (&iter, info->keys);
+      while (g_hash_table_iter_next (&iter, (gpointer *) &key, (gpointer *) &value))
+        {
+          if (G_VALUE_HOLDS_BOOLEAN (value))
+            g_variant_builder_add (&keys, "{sv}", key,
+                                   g_variant_new_boolean (g_value_get_boolean (value)));
+          else
+            g_variant_builder_add (&keys, "{sv}", key,
+                                   g_variant_new_string (g_value_get_string (value)));
+        }
+    }
+
+  if (info->authors != NULL)
+    authors = g_variant_new_strv ((const gchar * const *) info->authors, -1);
+
+  if (info->extension_types != NULL)
+    extension_types = g_variant_new_strv ((const gchar * const *) info->extension_types,
+                                          -1);
+
+  return g_variant_new (PEAS_PLUGIN_INFO_VARIANT_FORMAT_NEW,
+                        info->module_name, info->loader,
+                        g_variant_new_strv ((const gchar * const *) info->dependencies, -1),
+                        info->name, info->desc, info->icon_name,
+                        g_variant_new_maybe (G_VARIANT_TYPE_STRING_ARRAY, authors),
+                        info->copyright, info->website, info->version,
+                        info->help_uri,
+                        g_variant_new_maybe (G_VARIANT_TYPE_STRING_ARRAY,
+                                             extension_types),
+                        (guint32) info->iage,
+                        (gint32) info->priority,
+                        info->builtin ? TRUE : FALSE,
+                        info->thread_safe ? TRUE : FALSE,
+                        g_variant_builder_end (&keys));
+}
+
 /**
  * peas_plugin_info_is_loaded:
  * @info: A #PeasPluginInfo.
@@ -400,6 +612,47 @@ peas_plugin_info_is_builtin (const PeasPluginInfo *info)
   return info->builtin;
 }
 
+/**
+ * peas_plugin_info_is_thread_safe:
+ * @info: A #PeasPluginInfo.
+ *
+ * Gets if the extensions of the plugin can be called from any thread,
+ * concurrently with each other.
+ *
+ * This allows peas_extension_set_call_parallel() to call them from a
+ * thread pool. It is only honored for plugins loaded by the C loader.
+ *
+ * The relevant key in the plugin info file is "ThreadSafe".
+ *
+ * Returns: %TRUE if the plugin is thread-safe.
+ */
+gboolean
+peas_plugin_info_is_thread_safe (const PeasPluginInfo *info)
+{
+  g_return_val_if_fail (info != NULL, FALSE);
+
+  return info->thread_safe;
+}
+
+/**
+ * peas_plugin_info_get_priority:
+ * @info: A #PeasPluginInfo.
+ *
+ * Gets the priority of the plugin. The extensions of the plugins with
+ * a higher priority come first in a #PeasExtensionSet.
+ *
+ * The relevant key in the plugin info file is "Priority".
+ *
+ * Returns: the priority of the plugin, 0 if it was not specified.
+ */
+gint
+peas_plugin_info_get_priority (const PeasPluginInfo *info)
+{
+  g_return_val_if_fail (info != NULL, 0);
+
+  return info->priority;
+}
+
 /**
  * peas_plugin_info_get_module_name:
  * @info: A #PeasPluginInfo.
@@ -675,6 +928,32 @@ peas_plugin_info_get_help_uri (const PeasPluginInfo *info)
   return info->help_uri;
 }
 
+/**
+ * peas_plugin_info_get_extension_types:
+ * @info: A #PeasPluginInfo.
+ *
+ * Gets the names of the extension types the plugin implements, if it
+ * declares them.
+ *
+ * A plugin declaring its extension types is not actually loaded by its
+ * loader until an extension of one of those types is requested, using
+ * peas_engine_create_extension() or a #PeasExtensionSet. It still counts as
+ * loaded as far as the #PeasEngine is concerned. The names are #GType names,
+ * like "PeasActivatable".
+ *
+ * The relevant key in the plugin info file is "ExtensionTypes".
+ *
+ * Returns: (transfer none): the plugin's extension types, or %NULL if the
+ * plugin does not declare them.
+ */
+const gchar **
+peas_plugin_info_get_extension_types (const PeasPluginInfo *info)
+{
+  g_return_val_if_fail (info != NULL, NULL);
+
+  return (const gchar **) info->extension_types;
+}
+
 /**
  * peas_plugin_info_get_iage:
  * @info: A #PeasPluginInfo.
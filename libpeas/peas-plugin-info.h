@@ -43,6 +43,8 @@ GType         peas_plugin_info_get_type         (void) G_GNUC_CONST;
 gboolean      peas_plugin_info_is_loaded        (const PeasPluginInfo *info);
 gboolean      peas_plugin_info_is_available     (const PeasPluginInfo *info);
 gboolean      peas_plugin_info_is_builtin       (const PeasPluginInfo *info);
+gboolean      peas_plugin_info_is_thread_safe   (const PeasPluginInfo *info);
+gint          peas_plugin_info_get_priority     (const PeasPluginInfo *info);
 
 const gchar  *peas_plugin_info_get_module_name  (const PeasPluginInfo *info);
 const gchar  *peas_plugin_info_get_module_dir   (const PeasPluginInfo *info);
@@ -59,6 +61,8 @@ const gchar  *peas_plugin_info_get_website      (const PeasPluginInfo *info);
 const gchar  *peas_plugin_info_get_copyright    (const PeasPluginInfo *info);
 const gchar  *peas_plugin_info_get_version      (const PeasPluginInfo *info);
 const gchar  *peas_plugin_info_get_help_uri     (const PeasPluginInfo *info);
+const gchar **peas_plugin_info_get_extension_types
+                                                (const PeasPluginInfo *info);
 
 gint          peas_plugin_info_get_iage         (const PeasPluginInfo *info);
 const GHashTable *
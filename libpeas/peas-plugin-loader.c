@@ -24,6 +24,7 @@
 #endif
 
 #include "peas-plugin-loader.h"
+#include "peas-trace.h"
 
 G_DEFINE_ABSTRACT_TYPE (PeasPluginLoader, peas_plugin_loader, G_TYPE_OBJECT);
 
@@ -56,13 +57,20 @@ peas_plugin_loader_load (PeasPluginLoader *loader,
                          PeasPluginInfo   *info)
 {
   PeasPluginLoaderClass *klass;
+  gboolean loaded;
 
   g_return_val_if_fail (PEAS_IS_PLUGIN_LOADER (loader), FALSE);
 
   klass = PEAS_PLUGIN_LOADER_GET_CLASS (loader);
   g_return_val_if_fail (klass->load != NULL, FALSE);
 
-  return klass->load (loader, info);
+  PEAS_TRACE_BEGIN (G_OBJECT_TYPE_NAME (loader),
+                    peas_plugin_info_get_module_name (info));
+  loaded = klass->load (loader, info);
+  PEAS_TRACE_END (G_OBJECT_TYPE_NAME (loader),
+                  peas_plugin_info_get_module_name (info));
+
+  return loaded;
 }
 
 void
@@ -123,3 +131,59 @@ peas_plugin_loader_garbage_collect (PeasPluginLoader *loader)
   if (klass->garbage_collect != NULL)
     klass->garbage_collect (loader);
 }
+
+/*
+ * peas_plugin_loader_prefetch:
+ * @loader: A #PeasPluginLoader.
+ * @info: A #PeasPluginInfo.
+ *
+ * Does the blocking work needed to load @info, like reading files or
+ * opening shared libraries, so the following call to
+ * peas_plugin_loader_load() is faster.
+ *
+ * This is called from a worker thread, so the loaders implementing it
+ * must make it safe to use concurrently with their other methods.
+ */
+void
+peas_plugin_loader_prefetch (PeasPluginLoader *loader,
+                             PeasPluginInfo   *info)
+{
+  PeasPluginLoaderClass *klass;
+
+  g_return_if_fail (PEAS_IS_PLUGIN_LOADER (loader));
+
+  klass = PEAS_PLUGIN_LOADER_GET_CLASS (loader);
+
+  if (klass->prefetch != NULL)
+    {
+      PEAS_TRACE_BEGIN ("peas_plugin_loader_prefetch",
+                        peas_plugin_info_get_module_name (info));
+      klass->prefetch (loader, info);
+      PEAS_TRACE_END ("peas_plugin_loader_prefetch",
+                      peas_plugin_info_get_module_name (info));
+    }
+}
+
+/*
+ * peas_plugin_loader_release_prefetch:
+ * @loader: A #PeasPluginLoader.
+ * @info: A #PeasPluginInfo.
+ *
+ * Drops what peas_plugin_loader_prefetch() kept for @info, when the
+ * plugin will not be loaded after all. Loading the plugin releases it
+ * too, so this is only needed when the load is cancelled, fails or is
+ * deferred.
+ */
+void
+peas_plugin_loader_release_prefetch (PeasPluginLoader *loader,
+                                     PeasPluginInfo   *info)
+{
+  PeasPluginLoaderClass *klass;
+
+  g_return_if_fail (PEAS_IS_PLUGIN_LOADER (loader));
+
+  klass = PEAS_PLUGIN_LOADER_GET_CLASS (loader);
+
+  if (klass->release_prefetch != NULL)
+    klass->release_prefetch (loader, info);
+}
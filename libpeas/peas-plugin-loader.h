@@ -63,6 +63,11 @@ struct _PeasPluginLoaderClass {
                                            GParameter       *parameters);
 
   void          (*garbage_collect)        (PeasPluginLoader *loader);
+
+  void          (*prefetch)               (PeasPluginLoader *loader,
+                                           PeasPluginInfo   *info);
+  void          (*release_prefetch)       (PeasPluginLoader *loader,
+                                           PeasPluginInfo   *info);
 };
 
 GType         peas_plugin_loader_get_type             (void);
@@ -84,6 +89,10 @@ PeasExtension *peas_plugin_loader_create_extension    (PeasPluginLoader *loader,
                                                        guint             n_parameters,
                                                        GParameter       *parameters);
 void          peas_plugin_loader_garbage_collect      (PeasPluginLoader *loader);
+void          peas_plugin_loader_prefetch             (PeasPluginLoader *loader,
+                                                       PeasPluginInfo   *info);
+void          peas_plugin_loader_release_prefetch     (PeasPluginLoader *loader,
+                                                       PeasPluginInfo   *info);
 
 G_END_DECLS
 
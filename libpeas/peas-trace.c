@@ -0,0 +1,150 @@
+/*
+ * peas-trace.c
+ * This file is part of libpeas
+ *
+ * Copyright (C) 2026 - agent
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Library General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef G_OS_UNIX
+#include <unistd.h>
+#endif
+
+#include "libpeas/peas-trace.h"
+
+/*
+ * The spans are written in the Chrome trace event format, which can be
+ * loaded in chrome://tracing, as soon as they end or begin so that
+ * nothing is lost when the application crashes.
+ *
+ * The file always holds a complete JSON array: each event overwrites
+ * the closing bracket and writes it again. This way nothing needs to run
+ * at exit, which would not be safe once libpeas is unloaded.
+ */
+
+#define TRACE_END "\n]\n"
+
+gboolean _peas_trace_enabled = FALSE;
+
+static GStaticMutex trace_lock = G_STATIC_MUTEX_INIT;
+static FILE *trace_file = NULL;
+static GTimer *trace_timer = NULL;
+static GHashTable *trace_threads = NULL;
+static gulong trace_pid = 0;
+static gboolean trace_first_event = TRUE;
+
+static void
+write_escaped (const gchar *str)
+{
+  const gchar *p;
+
+  for (p = str; *p != '\0'; p++)
+    {
+      if (*p == '"' || *p == '\\')
+        fprintf (trace_file, "\\%c", *p);
+      else if ((guchar) *p < 0x20)
+        fprintf (trace_file, "\\u%04x", (guint) *p);
+      else
+        fputc (*p, trace_file);
+    }
+}
+
+void
+_peas_trace_init (void)
+{
+  const gchar *filename;
+
+  if (trace_file != NULL)
+    return;
+
+  filename = g_getenv ("PEAS_TRACE");
+  if (filename == NULL || *filename == '\0')
+    return;
+
+  trace_file = fopen (filename, "w");
+  if (trace_file == NULL)
+    {
+      g_warning ("Could not open the trace file '%s'", filename);
+      return;
+    }
+
+  trace_timer = g_timer_new ();
+  trace_threads = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+#ifdef G_OS_UNIX
+  trace_pid = (gulong) getpid ();
+#endif
+
+  fputs ("[" TRACE_END, trace_file);
+  fflush (trace_file);
+
+  _peas_trace_enabled = TRUE;
+}
+
+void
+_peas_trace_event (gchar        phase,
+                   const gchar *name,
+                   const gchar *detail)
+{
+  GThread *thread = g_thread_self ();
+  guint tid;
+
+  g_static_mutex_lock (&trace_lock);
+
+  if (trace_file == NULL)
+    {
+      g_static_mutex_unlock (&trace_lock);
+      return;
+    }
+
+  /* Number the threads in the order they are first seen */
+  tid = GPOINTER_TO_UINT (g_hash_table_lookup (trace_threads, thread));
+  if (tid == 0)
+    {
+      tid = g_hash_table_size (trace_threads) + 1;
+      g_hash_table_insert (trace_threads, thread, GUINT_TO_POINTER (tid));
+    }
+
+  fseek (trace_file, - (glong) strlen (TRACE_END), SEEK_END);
+
+  fprintf (trace_file,
+           "%s\n{\"name\":\"%s\",\"cat\":\"libpeas\",\"ph\":\"%c\","
+           "\"ts\":%.0f,\"pid\":%lu,\"tid\":%u",
+           trace_first_event ? "" : ",", name, phase,
+           g_timer_elapsed (trace_timer, NULL) * G_USEC_PER_SEC,
+           trace_pid, tid);
+
+  if (detail != NULL)
+    {
+      fputs (",\"args\":{\"detail\":\"", trace_file);
+      write_escaped (detail);
+      fputs ("\"}", trace_file);
+    }
+
+  fputs ("}" TRACE_END, trace_file);
+  fflush (trace_file);
+
+  trace_first_event = FALSE;
+
+  g_static_mutex_unlock (&trace_lock);
+}
@@ -0,0 +1,52 @@
+/*
+ * peas-trace.h
+ * This file is part of libpeas
+ *
+ * Copyright (C) 2026 - agent
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Library General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __PEAS_TRACE_H__
+#define __PEAS_TRACE_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Set when the PEAS_TRACE environment variable names a file to write
+ * the trace to, so the spans cost a single test otherwise. */
+extern gboolean _peas_trace_enabled;
+
+#define PEAS_TRACE_BEGIN(name, detail) \
+  G_STMT_START { \
+    if (G_UNLIKELY (_peas_trace_enabled)) \
+      _peas_trace_event ('B', (name), (detail)); \
+  } G_STMT_END
+
+#define PEAS_TRACE_END(name, detail) \
+  G_STMT_START { \
+    if (G_UNLIKELY (_peas_trace_enabled)) \
+      _peas_trace_event ('E', (name), (detail)); \
+  } G_STMT_END
+
+void  _peas_trace_init  (void);
+void  _peas_trace_event (gchar        phase,
+                         const gchar *name,
+                         const gchar *detail);
+
+G_END_DECLS
+
+#endif /* __PEAS_TRACE_H__ */
@@ -25,6 +25,7 @@
 #include "peas-extension.h"
 #include "peas-extension-base.h"
 #include "peas-extension-set.h"
+#include "peas-method.h"
 #include "peas-object-module.h"
 #include "peas-plugin-info.h"
 
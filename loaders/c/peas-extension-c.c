@@ -42,11 +42,15 @@ peas_extension_c_call (PeasExtension *exten,
                        GIArgument    *retval)
 {
   PeasExtensionC *cexten = PEAS_EXTENSION_C (exten);
-  GType gtype;
+  const PeasCallPlan *plan;
 
-  gtype = peas_extension_get_extension_type (exten);
+  plan = peas_gi_get_call_plan (peas_extension_get_extension_type (exten),
+                                method_name);
+  if (plan == NULL)
+    return FALSE;
 
-  return peas_method_apply (cexten->instance, gtype, method_name, args, retval);
+  return peas_method_apply_vfunc (cexten->instance, cexten->vtable, plan,
+                                  args, retval);
 }
 
 static void
@@ -83,6 +87,11 @@ peas_extension_c_new (GType    gtype,
                                            "extension-type", gtype,
                                            NULL));
   cexten->instance = instance;
+  cexten->vtable = peas_gi_get_vtable (instance, gtype);
+
+  if (cexten->vtable != NULL)
+    peas_extension_set_native (PEAS_EXTENSION (cexten), instance,
+                               cexten->vtable);
 
   return PEAS_EXTENSION (cexten);
 }
@@ -40,6 +40,9 @@ struct _PeasExtensionC {
   PeasExtension parent;
 
   GObject *instance;
+
+  /* Where the vfuncs of the extension type are found in instance */
+  gpointer vtable;
 };
 
 struct _PeasExtensionCClass {
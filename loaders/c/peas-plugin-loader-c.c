@@ -34,6 +34,10 @@
 struct _PeasPluginLoaderCPrivate
 {
   GHashTable *loaded_plugins;
+
+  /* Maps PeasPluginInfo to the GModule opened by prefetch() */
+  GStaticMutex prefetch_lock;
+  GHashTable *prefetched;
 };
 
 G_DEFINE_TYPE (PeasPluginLoaderC, peas_plugin_loader_c, PEAS_TYPE_PLUGIN_LOADER);
@@ -53,6 +57,68 @@ peas_plugin_loader_c_add_module_directory (PeasPluginLoader *loader,
   /* This is a no-op for C modules... */
 }
 
+static void
+peas_plugin_loader_c_prefetch (PeasPluginLoader *loader,
+                               PeasPluginInfo   *info)
+{
+  PeasPluginLoaderC *cloader = PEAS_PLUGIN_LOADER_C (loader);
+  GModule *library;
+  gchar *path;
+
+  path = g_module_build_path (peas_plugin_info_get_module_dir (info),
+                              peas_plugin_info_get_module_name (info));
+
+  /* Same as peas_object_module_load(), so it opens the same library */
+  if (G_MODULE_SUFFIX[0] != '\0' && g_str_has_suffix (path, "." G_MODULE_SUFFIX))
+    path[strlen (path) - strlen (G_MODULE_SUFFIX) - 1] = '\0';
+
+  /* The library is kept open until the plugin is loaded, which will then
+   * just take another reference on it. Errors are reported by the load. */
+  library = g_module_open (path, G_MODULE_BIND_LAZY);
+  g_free (path);
+
+  if (library == NULL)
+    return;
+
+  g_static_mutex_lock (&cloader->priv->prefetch_lock);
+
+  if (g_hash_table_lookup (cloader->priv->prefetched, info) == NULL)
+    {
+      g_hash_table_insert (cloader->priv->prefetched, info, library);
+      library = NULL;
+    }
+
+  g_static_mutex_unlock (&cloader->priv->prefetch_lock);
+
+  if (library != NULL)
+    g_module_close (library);
+}
+
+static void
+release_prefetched_library (PeasPluginLoaderC *cloader,
+                            PeasPluginInfo    *info)
+{
+  GModule *library;
+
+  g_static_mutex_lock (&cloader->priv->prefetch_lock);
+
+  library = (GModule *) g_hash_table_lookup (cloader->priv->prefetched, info);
+  if (library != NULL)
+    g_hash_table_steal (cloader->priv->prefetched, info);
+
+  g_static_mutex_unlock (&cloader->priv->prefetch_lock);
+
+  if (library != NULL)
+    g_module_close (library);
+}
+
+static void
+peas_plugin_loader_c_release_prefetch (PeasPluginLoader *loader,
+                                       PeasPluginInfo   *info)
+{
+  release_prefetched_library (PEAS_PLUGIN_LOADER_C (loader), info);
+}
+
 static gboolean
 peas_plugin_loader_c_load (PeasPluginLoader *loader,
                            PeasPluginInfo   *info)
@@ -84,9 +150,11 @@ peas_plugin_loader_c_load (PeasPluginLoader *loader,
       g_warning ("Could not load plugin module: '%s'",
                  peas_plugin_info_get_name (info));
 
+      release_prefetched_library (cloader, info);
       return FALSE;
     }
 
+  release_prefetched_library (cloader, info);
   return TRUE;
 }
 
@@ -180,6 +248,12 @@ peas_plugin_loader_c_init (PeasPluginLoaderC *self)
   /* loaded_plugins maps PeasPluginInfo to a PeasObjectModule */
   self->priv->loaded_plugins = g_hash_table_new (g_direct_hash,
                                                  g_direct_equal);
+
+  g_static_mutex_init (&self->priv->prefetch_lock);
+  self->priv->prefetched = g_hash_table_new_full (g_direct_hash,
+                                                  g_direct_equal,
+                                                  NULL,
+                                                  (GDestroyNotify) g_module_close);
 }
 
 static void
@@ -208,6 +282,8 @@ peas_plugin_loader_c_finalize (GObject *object)
   g_list_free (infos);
 
   g_hash_table_destroy (cloader->priv->loaded_plugins);
+  g_hash_table_destroy (cloader->priv->prefetched);
+  g_static_mutex_free (&cloader->priv->prefetch_lock);
 
   G_OBJECT_CLASS (peas_plugin_loader_c_parent_class)->finalize (object);
 }
@@ -225,6 +301,8 @@ peas_plugin_loader_c_class_init (PeasPluginLoaderCClass *klass)
   loader_class->unload = peas_plugin_loader_c_unload;
   loader_class->provides_extension = peas_plugin_loader_c_provides_extension;
   loader_class->create_extension = peas_plugin_loader_c_create_extension;
+  loader_class->prefetch = peas_plugin_loader_c_prefetch;
+  loader_class->release_prefetch = peas_plugin_loader_c_release_prefetch;
 
   g_type_class_add_private (object_class, sizeof (PeasPluginLoaderCPrivate));
 }
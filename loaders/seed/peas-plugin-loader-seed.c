@@ -64,8 +64,7 @@ peas_plugin_loader_seed_add_module_directory (PeasPluginLoader *loader,
 }
 
 static gchar *
-get_script_for_plugin_info (PeasPluginInfo   *info,
-                            SeedContext       context)
+read_script_for_plugin_info (PeasPluginInfo *info)
 {
   gchar *basename;
   gchar *filename;
@@ -84,6 +83,54 @@ get_script_for_plugin_info (PeasPluginInfo   *info,
   return script;
 }
 
+static gchar *
+get_script_for_plugin_info (PeasPluginLoaderSeed *sloader,
+                            PeasPluginInfo       *info)
+{
+  gchar *script;
+
+  g_static_mutex_lock (&sloader->prefetch_lock);
+
+  script = (gchar *) g_hash_table_lookup (sloader->prefetched_scripts, info);
+  if (script != NULL)
+    g_hash_table_steal (sloader->prefetched_scripts, info);
+
+  g_static_mutex_unlock (&sloader->prefetch_lock);
+
+  if (script == NULL)
+    script = read_script_for_plugin_info (info);
+
+  return script;
+}
+
+static void
+peas_plugin_loader_seed_prefetch (PeasPluginLoader *loader,
+                                  PeasPluginInfo   *info)
+{
+  PeasPluginLoaderSeed *sloader = PEAS_PLUGIN_LOADER_SEED (loader);
+  gchar *script;
+
+  /* The Seed context is not thread-safe, so only the script is read */
+  script = read_script_for_plugin_info (info);
+  if (script == NULL)
+    return;
+
+  g_static_mutex_lock (&sloader->prefetch_lock);
+  g_hash_table_insert (sloader->prefetched_scripts, info, script);
+  g_static_mutex_unlock (&sloader->prefetch_lock);
+}
+
+static void
+peas_plugin_loader_seed_release_prefetch (PeasPluginLoader *loader,
+                                          PeasPluginInfo   *info)
+{
+  PeasPluginLoaderSeed *sloader = PEAS_PLUGIN_LOADER_SEED (loader);
+
+  g_static_mutex_lock (&sloader->prefetch_lock);
+  g_hash_table_remove (sloader->prefetched_scripts, info);
+  g_static_mutex_unlock (&sloader->prefetch_lock);
+}
+
 static gboolean
 peas_plugin_loader_seed_load (PeasPluginLoader *loader,
                               PeasPluginInfo   *info)
@@ -98,7 +145,7 @@ peas_plugin_loader_seed_load (PeasPluginLoader *loader,
   context = seed_context_create (seed->group, NULL);
 
   seed_prepare_global_context (context);
-  script = get_script_for_plugin_info (info, context);
+  script = get_script_for_plugin_info (sloader, info);
 
   seed_simple_evaluate (context, script, &exc);
   g_free (script);
@@ -262,19 +309,41 @@ peas_plugin_loader_seed_init (PeasPluginLoaderSeed *sloader)
     seed = seed_init (NULL, NULL);
 
   sloader->loaded_plugins = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+  g_static_mutex_init (&sloader->prefetch_lock);
+  sloader->prefetched_scripts = g_hash_table_new_full (g_direct_hash,
+                                                       g_direct_equal,
+                                                       NULL,
+                                                       g_free);
+}
+
+static void
+peas_plugin_loader_seed_finalize (GObject *object)
+{
+  PeasPluginLoaderSeed *sloader = PEAS_PLUGIN_LOADER_SEED (object);
+
+  g_hash_table_destroy (sloader->prefetched_scripts);
+  g_static_mutex_free (&sloader->prefetch_lock);
+
+  G_OBJECT_CLASS (peas_plugin_loader_seed_parent_class)->finalize (object);
 }
 
 static void
 peas_plugin_loader_seed_class_init (PeasPluginLoaderSeedClass *klass)
 {
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
   PeasPluginLoaderClass *loader_class = PEAS_PLUGIN_LOADER_CLASS (klass);
 
+  object_class->finalize = peas_plugin_loader_seed_finalize;
+
   loader_class->add_module_directory = peas_plugin_loader_seed_add_module_directory;
   loader_class->load = peas_plugin_loader_seed_load;
   loader_class->provides_extension = peas_plugin_loader_seed_provides_extension;
   loader_class->create_extension = peas_plugin_loader_seed_create_extension;
   loader_class->unload = peas_plugin_loader_seed_unload;
   loader_class->garbage_collect = peas_plugin_loader_seed_garbage_collect;
+  loader_class->prefetch = peas_plugin_loader_seed_prefetch;
+  loader_class->release_prefetch = peas_plugin_loader_seed_release_prefetch;
 }
 
 G_MODULE_EXPORT void
@@ -41,6 +41,10 @@ struct _PeasPluginLoaderSeed {
   PeasPluginLoader parent;
 
   GHashTable *loaded_plugins;
+
+  /* Maps PeasPluginInfo to the script read by prefetch() */
+  GStaticMutex prefetch_lock;
+  GHashTable *prefetched_scripts;
 };
 
 struct _PeasPluginLoaderSeedClass {
@@ -23,10 +23,16 @@
 #include <config.h>
 #endif
 
+#include <string.h>
+#include <unistd.h>
+
 #include <glib.h>
+#include <glib/gstdio.h>
+#include <gmodule.h>
 #include <libpeas/peas.h>
 
 #include "testing/testing.h"
+#include "introspection/introspection-callable.h"
 
 typedef struct _TestFixture TestFixture;
 
@@ -148,6 +154,28 @@ test_engine_unload_plugin_with_self_dep (PeasEngine *engine)
   g_assert (!peas_plugin_info_is_loaded (info));
 }
 
+static void
+test_engine_get_dependents (PeasEngine *engine)
+{
+  PeasPluginInfo *info;
+  const GList *dependents;
+
+  info = peas_engine_get_plugin_info (engine, "loadable");
+
+  g_assert (info != NULL);
+
+  dependents = peas_engine_get_dependents (engine, info);
+
+  g_assert (dependents != NULL);
+  g_assert (dependents->data == peas_engine_get_plugin_info (engine, "has-dep"));
+  g_assert (dependents->next == NULL);
+
+  info = peas_engine_get_plugin_info (engine, "has-dep");
+
+  g_assert (info != NULL);
+  g_assert (peas_engine_get_dependents (engine, info) == NULL);
+}
+
 static void
 test_engine_unavailable_plugin (PeasEngine *engine)
 {
@@ -245,6 +273,662 @@ test_engine_loaded_plugins (PeasEngine *engine)
     g_strfreev (loaded_plugins);*/
 }
 
+#define N_PARALLEL_PLUGINS 40
+
+static void
+write_plugin_file (const gchar *dir,
+                   const gchar *basename,
+                   const gchar *module_name,
+                   const gchar *name)
+{
+  gchar *filename;
+  gchar *contents;
+
+  g_assert_cmpint (g_mkdir_with_parents (dir, 0755), ==, 0);
+
+  filename = g_build_filename (dir, basename, NULL);
+  contents = g_strdup_printf ("[Plugin]\n"
+                              "Module=%s\n"
+                              "Name=%s\n"
+                              "IAge=2\n", module_name, name);
+
+  g_assert (g_file_set_contents (filename, contents, -1, NULL));
+
+  g_free (contents);
+  g_free (filename);
+}
+
+static void
+remove_plugin_file (const gchar *dir,
+                    const gchar *basename)
+{
+  gchar *filename;
+
+  filename = g_build_filename (dir, basename, NULL);
+  g_unlink (filename);
+  g_free (filename);
+}
+
+static void
+test_engine_parallel_scan (PeasEngine *engine)
+{
+  gchar *base_dir, *user_dir, *system_dir, *subdir;
+  PeasPluginInfo *info;
+  guint i;
+
+  base_dir = g_strdup_printf ("%s/libpeas-parallel-%lu",
+                              g_get_tmp_dir (), (gulong) getpid ());
+  user_dir = g_build_filename (base_dir, "user", NULL);
+  system_dir = g_build_filename (base_dir, "system", NULL);
+  subdir = g_build_filename (user_dir, "subdir", NULL);
+
+  /* The search paths do not exist yet, so the parallel
+   * scan below is the first one to find their plugins */
+  peas_engine_add_search_path (engine, user_dir, NULL);
+  peas_engine_add_search_path (engine, system_dir, NULL);
+
+  /* More plugins than a single scan job handles */
+  for (i = 0; i < N_PARALLEL_PLUGINS; i++)
+    {
+      gchar *basename, *module_name;
+
+      basename = g_strdup_printf ("parallel-%02u.plugin", i);
+      module_name = g_strdup_printf ("parallel-%02u", i);
+
+      write_plugin_file (system_dir, basename, module_name, "Parallel");
+
+      g_free (module_name);
+      g_free (basename);
+    }
+
+  write_plugin_file (system_dir, "override.plugin",
+                     "parallel-override", "System");
+  write_plugin_file (user_dir, "override.plugin",
+                     "parallel-override", "User");
+  write_plugin_file (subdir, "subdir.plugin", "parallel-subdir", "Subdir");
+
+  g_object_set (engine, "parallel-scan", TRUE, NULL);
+  peas_engine_rescan_plugins (engine);
+  g_object_set (engine, "parallel-scan", FALSE, NULL);
+
+  for (i = 0; i < N_PARALLEL_PLUGINS; i++)
+    {
+      gchar *module_name;
+
+      module_name = g_strdup_printf ("parallel-%02u", i);
+      g_assert (peas_engine_get_plugin_info (engine, module_name) != NULL);
+      g_free (module_name);
+    }
+
+  g_assert (peas_engine_get_plugin_info (engine, "parallel-subdir") != NULL);
+
+  /* The user plugin overrides the system plugin */
+  info = peas_engine_get_plugin_info (engine, "parallel-override");
+  g_assert (info != NULL);
+  g_assert_cmpstr (peas_plugin_info_get_name (info), ==, "User");
+  g_assert_cmpstr (peas_plugin_info_get_module_dir (info), ==, user_dir);
+
+  /* The plugins found before are still there */
+  g_assert (peas_engine_get_plugin_info (engine, "loadable") != NULL);
+  g_assert (peas_engine_get_plugin_info (engine, "callable") != NULL);
+
+  for (i = 0; i < N_PARALLEL_PLUGINS; i++)
+    {
+      gchar *basename;
+
+      basename = g_strdup_printf ("parallel-%02u.plugin", i);
+      remove_plugin_file (system_dir, basename);
+      g_free (basename);
+    }
+
+  remove_plugin_file (system_dir, "override.plugin");
+  remove_plugin_file (user_dir, "override.plugin");
+  remove_plugin_file (subdir, "subdir.plugin");
+
+  g_rmdir (subdir);
+  g_rmdir (user_dir);
+  g_rmdir (system_dir);
+  g_rmdir (base_dir);
+
+  g_free (subdir);
+  g_free (system_dir);
+  g_free (user_dir);
+  g_free (base_dir);
+}
+
+static void
+loaded_plugins_changed_cb (PeasEngine  *engine,
+                           GList       *plugins,
+                           GList      **changed)
+{
+  g_assert (*changed == NULL);
+
+  *changed = g_list_copy (plugins);
+}
+
+static void
+count_notify_cb (PeasEngine *engine,
+                 GParamSpec *pspec,
+                 gint       *n_notify)
+{
+  ++(*n_notify);
+}
+
+static void
+test_engine_transaction (PeasEngine *engine)
+{
+  PeasPluginInfo *loadable, *has_dep, *builtin;
+  GList *changed = NULL;
+  gint n_notify = 0;
+
+  g_signal_connect (engine,
+                    "loaded-plugins-changed",
+                    G_CALLBACK (loaded_plugins_changed_cb),
+                    (gpointer) &changed);
+  g_signal_connect (engine,
+                    "notify::loaded-plugins",
+                    G_CALLBACK (count_notify_cb),
+                    (gpointer) &n_notify);
+
+  loadable = peas_engine_get_plugin_info (engine, "loadable");
+  has_dep = peas_engine_get_plugin_info (engine, "has-dep");
+  builtin = peas_engine_get_plugin_info (engine, "builtin");
+
+  /* A single load is a transaction on its own */
+  g_assert (peas_engine_load_plugin (engine, has_dep));
+
+  g_assert_cmpint (n_notify, ==, 1);
+  g_assert_cmpuint (g_list_length (changed), ==, 2);
+  g_assert (g_list_find (changed, loadable) != NULL);
+  g_assert (g_list_find (changed, has_dep) != NULL);
+
+  g_list_free (changed);
+  changed = NULL;
+  n_notify = 0;
+
+  peas_engine_begin_transaction (engine);
+
+  g_assert (peas_engine_unload_plugin (engine, loadable));
+  g_assert (peas_engine_load_plugin (engine, builtin));
+  g_assert (peas_engine_load_plugin (engine, has_dep));
+
+  g_assert_cmpint (n_notify, ==, 0);
+  g_assert (changed == NULL);
+
+  peas_engine_commit_transaction (engine);
+
+  /* loadable and has-dep were unloaded and loaded again */
+  g_assert_cmpint (n_notify, ==, 1);
+  g_assert_cmpuint (g_list_length (changed), ==, 1);
+  g_assert (changed->data == builtin);
+
+  g_list_free (changed);
+
+  g_signal_handlers_disconnect_by_func (engine,
+                                        loaded_plugins_changed_cb,
+                                        &changed);
+  g_signal_handlers_disconnect_by_func (engine, count_notify_cb, &n_notify);
+}
+
+#define N_PERF_PLUGINS 10000
+
+static void
+test_engine_scan_many_plugins (PeasEngine *engine)
+{
+  gchar *dir;
+  gchar *cache_dir;
+  guint i;
+  gdouble elapsed;
+
+  dir = g_strdup_printf ("%s/libpeas-perf-%lu",
+                         g_get_tmp_dir (), (gulong) getpid ());
+  g_assert_cmpint (g_mkdir_with_parents (dir, 0755), ==, 0);
+
+  for (i = 0; i < N_PERF_PLUGINS; i++)
+    {
+      gchar *filename;
+      gchar *contents;
+
+      filename = g_strdup_printf ("%s/perf-%05u.plugin", dir, i);
+      contents = g_strdup_printf ("[Plugin]\n"
+                                  "Module=perf-%05u\n"
+                                  "Name=Perf %u\n"
+                                  "IAge=2\n", i, i);
+
+      g_assert (g_file_set_contents (filename, contents, -1, NULL));
+
+      g_free (contents);
+      g_free (filename);
+    }
+
+  /* Measure the parsing and the duplicate checks, not the cache */
+  cache_dir = g_strdup (g_getenv ("PEAS_PLUGIN_CACHE_DIR"));
+  g_setenv ("PEAS_PLUGIN_CACHE_DIR", "", TRUE);
+
+  g_test_timer_start ();
+  peas_engine_add_search_path (engine, dir, NULL);
+  elapsed = g_test_timer_elapsed ();
+
+  g_test_minimized_result (elapsed, "Scanned %u plugins in %6.3f seconds",
+                           N_PERF_PLUGINS, elapsed);
+
+  /* Every plugin is now a duplicate */
+  g_test_timer_start ();
+  peas_engine_rescan_plugins (engine);
+  elapsed = g_test_timer_elapsed ();
+
+  g_test_minimized_result (elapsed, "Rescanned %u plugins in %6.3f seconds",
+                           N_PERF_PLUGINS, elapsed);
+
+  g_setenv ("PEAS_PLUGIN_CACHE_DIR", cache_dir, TRUE);
+
+  g_assert (peas_engine_get_plugin_info (engine, "perf-00000") != NULL);
+  g_assert (peas_engine_get_plugin_info (engine, "perf-09999") != NULL);
+
+  /* Compare the lookups with the linear walk the engine used before */
+  g_test_timer_start ();
+  for (i = 0; i < N_PERF_PLUGINS; i++)
+    {
+      gchar module_name[16];
+
+      g_snprintf (module_name, sizeof (module_name), "perf-%05u", i);
+      g_assert (peas_engine_get_plugin_info (engine, module_name) != NULL);
+    }
+  elapsed = g_test_timer_elapsed ();
+
+  g_test_minimized_result (elapsed, "Looked up %u plugins in %6.3f seconds",
+                           N_PERF_PLUGINS, elapsed);
+
+  g_test_timer_start ();
+  for (i = 0; i < N_PERF_PLUGINS; i++)
+    {
+      const GList *item;
+      gchar module_name[16];
+
+      g_snprintf (module_name, sizeof (module_name), "perf-%05u", i);
+
+      for (item = peas_engine_get_plugin_list (engine);
+           item != NULL; item = item->next)
+        {
+          PeasPluginInfo *info = (PeasPluginInfo *) item->data;
+
+          if (strcmp (peas_plugin_info_get_module_name (info), module_name) == 0)
+            break;
+        }
+
+      g_assert (item != NULL);
+    }
+  elapsed = g_test_timer_elapsed ();
+
+  g_test_message ("Walked the plugin list for %u plugins in %6.3f seconds",
+                  N_PERF_PLUGINS, elapsed);
+
+  for (i = 0; i < N_PERF_PLUGINS; i++)
+    {
+      gchar *filename;
+
+      filename = g_strdup_printf ("%s/perf-%05u.plugin", dir, i);
+      g_unlink (filename);
+      g_free (filename);
+    }
+
+  g_rmdir (dir);
+
+  g_free (cache_dir);
+  g_free (dir);
+}
+
+static void
+test_engine_set_loaded_plugins (PeasEngine *engine)
+{
+  PeasPluginInfo *loadable, *has_dep;
+  const gchar *with_dep[] = { "has-dep", NULL };
+  const gchar *without_dep[] = { "loadable", "does-not-exist", NULL };
+
+  loadable = peas_engine_get_plugin_info (engine, "loadable");
+  has_dep = peas_engine_get_plugin_info (engine, "has-dep");
+
+  /* The dependencies are loaded too */
+  peas_engine_set_loaded_plugins (engine, with_dep);
+
+  g_assert (peas_plugin_info_is_loaded (has_dep));
+  g_assert (peas_plugin_info_is_loaded (loadable));
+
+  peas_engine_set_loaded_plugins (engine, without_dep);
+
+  g_assert (!peas_plugin_info_is_loaded (has_dep));
+  g_assert (peas_plugin_info_is_loaded (loadable));
+
+  peas_engine_set_loaded_plugins (engine, NULL);
+
+  g_assert (!peas_plugin_info_is_loaded (loadable));
+}
+
+static void
+test_engine_set_loaded_plugins_prefetch (PeasEngine *engine)
+{
+  g_object_set (engine, "prefetch-plugins", TRUE, NULL);
+  test_engine_set_loaded_plugins (engine);
+  g_object_set (engine, "prefetch-plugins", FALSE, NULL);
+}
+
+static void
+load_plugin_async_cb (PeasEngine    *engine,
+                      GAsyncResult  *result,
+                      GError       **error)
+{
+  g_assert (*error == NULL);
+
+  if (peas_engine_load_plugin_finish (engine, result, error))
+    g_assert (*error == NULL);
+  else
+    g_assert (*error != NULL);
+
+  g_main_loop_quit (g_object_get_data (G_OBJECT (engine), "main-loop"));
+}
+
+static void
+test_engine_load_plugin_async (PeasEngine *engine)
+{
+  PeasPluginInfo *info;
+  GMainLoop *loop;
+  GCancellable *cancellable;
+  GError *error = NULL;
+
+  loop = g_main_loop_new (NULL, FALSE);
+  g_object_set_data (G_OBJECT (engine), "main-loop", loop);
+
+  info = peas_engine_get_plugin_info (engine, "has-dep");
+
+  /* Cancelled before the plugins are loaded */
+  cancellable = g_cancellable_new ();
+  peas_engine_load_plugin_async (engine, info, cancellable,
+                                 (GAsyncReadyCallback) load_plugin_async_cb,
+                                 &error);
+  g_cancellable_cancel (cancellable);
+  g_main_loop_run (loop);
+
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+  g_assert (!peas_plugin_info_is_loaded (info));
+
+  g_clear_error (&error);
+  g_object_unref (cancellable);
+
+  peas_engine_load_plugin_async (engine, info, NULL,
+                                 (GAsyncReadyCallback) load_plugin_async_cb,
+                                 &error);
+
+  /* The plugins are loaded in the main loop */
+  g_assert (!peas_plugin_info_is_loaded (info));
+
+  g_main_loop_run (loop);
+
+  g_assert_no_error (error);
+  g_assert (peas_plugin_info_is_loaded (info));
+  g_assert (peas_plugin_info_is_loaded (peas_engine_get_plugin_info (engine,
+                                                                     "loadable")));
+
+  g_object_set_data (G_OBJECT (engine), "main-loop", NULL);
+  g_main_loop_unref (loop);
+}
+
+static void
+test_engine_load_plugin_async_unavailable (PeasEngine *engine)
+{
+  PeasPluginInfo *info;
+  GMainLoop *loop;
+  GError *error = NULL;
+  guint i;
+
+  loop = g_main_loop_new (NULL, FALSE);
+  g_object_set_data (G_OBJECT (engine), "main-loop", loop);
+
+  info = peas_engine_get_plugin_info (engine, "unavailable");
+
+  /* Loading it fails on its missing dependency, and makes it unavailable,
+   * so the next time it is not even scheduled */
+  for (i = 0; i < 2; i++)
+    {
+      peas_engine_load_plugin_async (engine, info, NULL,
+                                     (GAsyncReadyCallback) load_plugin_async_cb,
+                                     &error);
+      g_main_loop_run (loop);
+
+      g_assert_error (error, PEAS_ENGINE_ERROR,
+                      PEAS_ENGINE_ERROR_LOADING_FAILED);
+      g_assert (!peas_plugin_info_is_loaded (info));
+      g_assert (!peas_plugin_info_is_available (info));
+
+      g_clear_error (&error);
+    }
+
+  g_object_set_data (G_OBJECT (engine), "main-loop", NULL);
+  g_main_loop_unref (loop);
+}
+
+#define N_LOAD_PERF_PLUGINS 200
+#define N_LOAD_PERF_ROOTS    10
+
+/* Copies the perf plugin module once for each plugin, as a module
+ * can only be loaded once. All but the first plugins depend on one
+ * of the first ones, so they are loaded in two wavefronts. */
+static void
+write_load_perf_plugins (const gchar *dir,
+                         const gchar *prefix,
+                         const gchar *library,
+                         gsize        library_len)
+{
+  guint i;
+
+  for (i = 0; i < N_LOAD_PERF_PLUGINS; i++)
+    {
+      gchar *module_name;
+      gchar *filename;
+      gchar *contents;
+      gchar *depends;
+
+      module_name = g_strdup_printf ("%s-%03u", prefix, i);
+
+      filename = g_module_build_path (dir, module_name);
+      g_assert (g_file_set_contents (filename, library, library_len, NULL));
+      g_free (filename);
+
+      if (i < N_LOAD_PERF_ROOTS)
+        depends = g_strdup ("");
+      else
+        depends = g_strdup_printf ("Depends=%s-%03u\n",
+                                   prefix, i % N_LOAD_PERF_ROOTS);
+
+      filename = g_strdup_printf ("%s/%s.plugin", dir, module_name);
+      contents = g_strdup_printf ("[Plugin]\n"
+                                  "Module=%s\n"
+                                  "%s"
+                                  "Name=%s\n"
+                                  "IAge=2\n",
+                                  module_name, depends, module_name);
+      g_assert (g_file_set_contents (filename, contents, -1, NULL));
+
+      g_free (contents);
+      g_free (filename);
+      g_free (depends);
+      g_free (module_name);
+    }
+}
+
+static void
+remove_load_perf_plugins (const gchar *dir,
+                          const gchar *prefix)
+{
+  guint i;
+
+  for (i = 0; i < N_LOAD_PERF_PLUGINS; i++)
+    {
+      gchar *module_name;
+      gchar *filename;
+
+      module_name = g_strdup_printf ("%s-%03u", prefix, i);
+
+      filename = g_module_build_path (dir, module_name);
+      g_unlink (filename);
+      g_free (filename);
+
+      filename = g_strdup_printf ("%s/%s.plugin", dir, module_name);
+      g_unlink (filename);
+      g_free (filename);
+
+      g_free (module_name);
+    }
+}
+
+static GList *
+get_load_perf_plugins (PeasEngine  *engine,
+                       const gchar *prefix)
+{
+  GList *infos = NULL;
+  guint i;
+
+  for (i = N_LOAD_PERF_PLUGINS; i > 0; i--)
+    {
+      gchar *module_name;
+      PeasPluginInfo *info;
+
+      module_name = g_strdup_printf ("%s-%03u", prefix, i - 1);
+      info = peas_engine_get_plugin_info (engine, module_name);
+      g_free (module_name);
+
+      g_assert (info != NULL);
+      infos = g_list_prepend (infos, info);
+    }
+
+  return infos;
+}
+
+static void
+load_plugins_async_cb (PeasEngine    *engine,
+                       GAsyncResult  *result,
+                       GError       **error)
+{
+  peas_engine_load_plugins_finish (engine, result, error);
+
+  g_main_loop_quit (g_object_get_data (G_OBJECT (engine), "main-loop"));
+}
+
+static void
+test_engine_load_many_plugins (PeasEngine *engine)
+{
+  gchar *library_path;
+  gchar *library;
+  gsize library_len;
+  gchar *dir;
+  GList *infos, *l;
+  GMainLoop *loop;
+  GError *error = NULL;
+  gdouble elapsed;
+
+  library_path = g_module_build_path (BUILDDIR "/tests/libpeas/plugins/perf/.libs",
+                                      "perf");
+  g_assert (g_file_get_contents (library_path, &library, &library_len, NULL));
+
+  dir = g_strdup_printf ("%s/libpeas-load-perf-%lu",
+                         g_get_tmp_dir (), (gulong) getpid ());
+  g_assert_cmpint (g_mkdir_with_parents (dir, 0755), ==, 0);
+
+  write_load_perf_plugins (dir, "perf-serial", library, library_len);
+  write_load_perf_plugins (dir, "perf-async", library, library_len);
+  peas_engine_add_search_path (engine, dir, NULL);
+
+  /* One plugin after the other */
+  infos = get_load_perf_plugins (engine, "perf-serial");
+
+  g_test_timer_start ();
+  for (l = infos; l != NULL; l = l->next)
+    g_assert (peas_engine_load_plugin (engine, (PeasPluginInfo *) l->data));
+  elapsed = g_test_timer_elapsed ();
+
+  g_test_minimized_result (elapsed, "Loaded %u plugins serially in %6.3f seconds",
+                           N_LOAD_PERF_PLUGINS, elapsed);
+
+  g_list_free (infos);
+
+  /* The independent plugins concurrently */
+  infos = get_load_perf_plugins (engine, "perf-async");
+
+  loop = g_main_loop_new (NULL, FALSE);
+  g_object_set_data (G_OBJECT (engine), "main-loop", loop);
+
+  g_test_timer_start ();
+  peas_engine_load_plugins_async (engine, infos, NULL,
+                                  (GAsyncReadyCallback) load_plugins_async_cb,
+                                  &error);
+  g_main_loop_run (loop);
+  elapsed = g_test_timer_elapsed ();
+
+  g_assert_no_error (error);
+  g_test_minimized_result (elapsed, "Loaded %u plugins in wavefronts in %6.3f seconds",
+                           N_LOAD_PERF_PLUGINS, elapsed);
+
+  for (l = infos; l != NULL; l = l->next)
+    g_assert (peas_plugin_info_is_loaded ((PeasPluginInfo *) l->data));
+
+  g_list_free (infos);
+
+  g_object_set_data (G_OBJECT (engine), "main-loop", NULL);
+  g_main_loop_unref (loop);
+
+  remove_load_perf_plugins (dir, "perf-serial");
+  remove_load_perf_plugins (dir, "perf-async");
+  g_rmdir (dir);
+
+  g_free (dir);
+  g_free (library);
+  g_free (library_path);
+}
+
+static void
+test_engine_extension_types (PeasEngine *engine)
+{
+  PeasPluginInfo *info;
+  GList *providers;
+  PeasExtension *extension;
+
+  info = peas_engine_get_plugin_info (engine, "deferred");
+
+  providers = (GList *) peas_engine_get_plugins_for_extension_type (engine,
+                                                                    INTROSPECTION_TYPE_CALLABLE);
+  g_assert (g_list_find (providers, info) != NULL);
+
+  providers = (GList *) peas_engine_get_plugins_for_extension_type (engine,
+                                                                    PEAS_TYPE_ACTIVATABLE);
+  g_assert (g_list_find (providers, info) == NULL);
+
+  g_assert (peas_engine_load_plugin (engine, info));
+  g_assert (peas_plugin_info_is_loaded (info));
+
+  /* The module is not loaded until an extension is requested */
+  g_assert (g_type_from_name ("TestingDeferredPlugin") == G_TYPE_INVALID);
+
+  g_assert (peas_engine_provides_extension (engine, info,
+                                            INTROSPECTION_TYPE_CALLABLE));
+  g_assert (!peas_engine_provides_extension (engine, info,
+                                             PEAS_TYPE_ACTIVATABLE));
+  g_assert (peas_engine_create_extension (engine, info,
+                                          PEAS_TYPE_ACTIVATABLE,
+                                          NULL) == NULL);
+
+  g_assert (g_type_from_name ("TestingDeferredPlugin") == G_TYPE_INVALID);
+
+  extension = peas_engine_create_extension (engine, info,
+                                            INTROSPECTION_TYPE_CALLABLE,
+                                            NULL);
+  g_assert (INTROSPECTION_IS_CALLABLE (extension));
+  g_assert (g_type_from_name ("TestingDeferredPlugin") != G_TYPE_INVALID);
+
+  g_object_unref (extension);
+
+  g_assert (peas_engine_unload_plugin (engine, info));
+  g_assert (!peas_plugin_info_is_loaded (info));
+}
+
 #if CANNOT_TEST
 static void
 test_engine_disable_loader (PeasEngine *engine)
@@ -268,6 +952,9 @@ int
 main (int    argc,
       char **argv)
 {
+  /* The engine leaves initializing the thread system to the application */
+  g_thread_init (NULL);
+
   g_test_init (&argc, &argv, NULL);
 
   g_type_init ();
@@ -287,10 +974,29 @@ main (int    argc,
   TEST ("unload-plugin-with-dep", unload_plugin_with_dep);
   TEST ("unload-plugin-with-self-dep", unload_plugin_with_self_dep);
 
+  TEST ("get-dependents", get_dependents);
+
   TEST ("unavailable-plugin", unavailable_plugin);
 
+  TEST ("load-plugin-async", load_plugin_async);
+  TEST ("load-plugin-async-unavailable", load_plugin_async_unavailable);
+  TEST ("extension-types", extension_types);
+  TEST ("set-loaded-plugins", set_loaded_plugins);
+  TEST ("set-loaded-plugins-prefetch", set_loaded_plugins_prefetch);
+  TEST ("transaction", transaction);
+
+  if (g_test_perf ())
+    TEST ("load-many-plugins", load_many_plugins);
+
   TEST ("loaded-plugins", loaded_plugins);
 
+  /* Adds search paths to the engine */
+  TEST ("parallel-scan", parallel_scan);
+
+  /* Adds a search path to the engine, so must be the last test */
+  if (g_test_perf ())
+    TEST ("scan-many-plugins", scan_many_plugins);
+
 #if CANNOT_TEST
   TEST ("disable-loader", disable_loader);
 #endif
@@ -24,12 +24,16 @@
 #endif
 
 #include <stdlib.h>
+#include <string.h>
 
 #include <glib.h>
 #include <libpeas/peas.h>
 
 #include "testing/testing.h"
 
+#include "introspection/introspection-callable.h"
+#include "callable-wrappers.h"
+
 /* TODO:
  *        - Check that extensions sets only contain extensions of their type
  */
@@ -193,10 +197,562 @@ test_extension_set_call_invalid (TestFixture *fixture)
   g_test_trap_assert_stderr ("*Method 'PeasActivatable.invalid' not found*");
 }
 
+static void
+test_extension_set_call_method (TestFixture *fixture)
+{
+  PeasMethod *method;
+
+  test_extension_set_activate (fixture);
+
+  method = peas_method_new (PEAS_TYPE_ACTIVATABLE, "activate");
+
+  g_assert (method != NULL);
+  g_assert (peas_method_get_extension_type (method) == PEAS_TYPE_ACTIVATABLE);
+  g_assert_cmpstr (peas_method_get_name (method), ==, "activate");
+
+  g_assert (peas_extension_set_call_method (fixture->extension_set, method));
+
+  peas_method_unref (method);
+}
+
+static void
+count_extensions_cb (PeasExtensionSet *set,
+                     PeasPluginInfo   *info,
+                     PeasExtension    *exten,
+                     gint             *count)
+{
+  g_assert (PEAS_IS_ACTIVATABLE (exten));
+  g_assert (peas_extension_set_get_extension (set, info) == exten);
+
+  ++(*count);
+}
+
+static void
+test_extension_set_foreach (TestFixture *fixture)
+{
+  gint count = 0;
+
+  test_extension_set_activate (fixture);
+
+  peas_extension_set_foreach (fixture->extension_set,
+                              (PeasExtensionSetForeachFunc) count_extensions_cb,
+                              &count);
+
+  g_assert_cmpint (count, ==, G_N_ELEMENTS (loadable_plugins));
+}
+
+static void
+check_order_cb (PeasExtensionSet *set,
+                PeasPluginInfo   *info,
+                PeasExtension    *exten,
+                gint             *index)
+{
+  /* Extensions are visited in the order their plugins were loaded */
+  g_assert_cmpstr (peas_plugin_info_get_module_name (info), ==,
+                   loadable_plugins[(*index)++]);
+}
+
+static void
+test_extension_set_foreach_order (TestFixture *fixture)
+{
+  gint index = 0;
+
+  test_extension_set_activate (fixture);
+
+  peas_extension_set_foreach (fixture->extension_set,
+                              (PeasExtensionSetForeachFunc) check_order_cb,
+                              &index);
+
+  g_assert_cmpint (index, ==, G_N_ELEMENTS (loadable_plugins));
+}
+
+static gint
+plugin_position (PeasPluginInfo *info)
+{
+  gint i;
+
+  for (i = 0; i < G_N_ELEMENTS (loadable_plugins); ++i)
+    {
+      if (g_str_equal (peas_plugin_info_get_module_name (info),
+                       loadable_plugins[i]))
+        return i;
+    }
+
+  g_assert_not_reached ();
+}
+
+static gint
+reverse_compare (PeasPluginInfo *a,
+                 PeasPluginInfo *b,
+                 gpointer        data)
+{
+  return plugin_position (b) - plugin_position (a);
+}
+
+static void
+check_reverse_order_cb (PeasExtensionSet *set,
+                        PeasPluginInfo   *info,
+                        PeasExtension    *exten,
+                        gint             *index)
+{
+  g_assert_cmpint (plugin_position (info), ==,
+                   G_N_ELEMENTS (loadable_plugins) - ++(*index));
+}
+
+static void
+test_extension_set_sort_func (TestFixture *fixture)
+{
+  gint index = 0;
+
+  /* Extensions are inserted in place as their plugins are loaded */
+  peas_extension_set_set_sort_func (fixture->extension_set,
+                                    reverse_compare, NULL, NULL);
+
+  test_extension_set_activate (fixture);
+
+  peas_extension_set_foreach (fixture->extension_set,
+                              (PeasExtensionSetForeachFunc) check_reverse_order_cb,
+                              &index);
+  g_assert_cmpint (index, ==, G_N_ELEMENTS (loadable_plugins));
+
+  /* Going back to the default order sorts the set again */
+  peas_extension_set_set_sort_func (fixture->extension_set, NULL, NULL, NULL);
+
+  index = 0;
+  peas_extension_set_foreach (fixture->extension_set,
+                              (PeasExtensionSetForeachFunc) check_order_cb,
+                              &index);
+  g_assert_cmpint (index, ==, G_N_ELEMENTS (loadable_plugins));
+}
+
+static void
+unload_all_cb (PeasExtensionSet *set,
+               PeasPluginInfo   *info,
+               PeasExtension    *exten,
+               TestFixture      *fixture)
+{
+  gint i;
+
+  /* Only the first extension should be visited */
+  g_assert_cmpint (fixture->active, ==, G_N_ELEMENTS (loadable_plugins));
+
+  for (i = G_N_ELEMENTS (loadable_plugins); i > 0; --i)
+    {
+      info = peas_engine_get_plugin_info (fixture->engine,
+                                          loadable_plugins[i - 1]);
+      g_assert (peas_engine_unload_plugin (fixture->engine, info));
+    }
+
+  /* The extension must stay usable until the end of the callback */
+  g_assert (PEAS_IS_ACTIVATABLE (exten));
+  g_assert (peas_extension_set_get_extension (set, info) == NULL);
+}
+
+static void
+test_extension_set_foreach_unload (TestFixture *fixture)
+{
+  test_extension_set_activate (fixture);
+
+  peas_extension_set_foreach (fixture->extension_set,
+                              (PeasExtensionSetForeachFunc) unload_all_cb,
+                              fixture);
+
+  g_assert_cmpint (fixture->active, ==, 0);
+}
+
+static void
+test_extension_set_lazy (TestFixture *fixture)
+{
+  TestFixture lazy = { NULL, NULL, 0 };
+  PeasPluginInfo *info;
+  gint i, count = 0;
+
+  lazy.engine = fixture->engine;
+  lazy.extension_set = peas_extension_set_new_lazy (fixture->engine,
+                                                    PEAS_TYPE_ACTIVATABLE,
+                                                    "object", NULL,
+                                                    NULL);
+
+  g_signal_connect (lazy.extension_set,
+                    "extension-added",
+                    G_CALLBACK (extension_added_cb),
+                    &lazy);
+  g_signal_connect (lazy.extension_set,
+                    "extension-removed",
+                    G_CALLBACK (extension_removed_cb),
+                    &lazy);
+
+  test_extension_set_activate (fixture);
+
+  /* Nothing is created until it is needed */
+  g_assert_cmpint (lazy.active, ==, 0);
+
+  info = peas_engine_get_plugin_info (fixture->engine, loadable_plugins[0]);
+  g_assert (PEAS_IS_ACTIVATABLE (peas_extension_set_get_extension (lazy.extension_set,
+                                                                   info)));
+  g_assert_cmpint (lazy.active, ==, 1);
+
+  peas_extension_set_foreach (lazy.extension_set,
+                              (PeasExtensionSetForeachFunc) count_extensions_cb,
+                              &count);
+  g_assert_cmpint (count, ==, G_N_ELEMENTS (loadable_plugins));
+  g_assert_cmpint (lazy.active, ==, G_N_ELEMENTS (loadable_plugins));
+
+  for (i = G_N_ELEMENTS (loadable_plugins); i > 0; --i)
+    {
+      info = peas_engine_get_plugin_info (fixture->engine,
+                                          loadable_plugins[i - 1]);
+      g_assert (peas_engine_unload_plugin (fixture->engine, info));
+    }
+
+  g_assert_cmpint (lazy.active, ==, 0);
+
+  g_object_unref (lazy.extension_set);
+}
+
+static gboolean
+not_self_dep (PeasPluginInfo *info,
+              gint           *n_calls)
+{
+  ++(*n_calls);
+
+  return !g_str_equal (peas_plugin_info_get_module_name (info), "self-dep");
+}
+
+static void
+test_extension_set_filtered (TestFixture *fixture)
+{
+  PeasExtensionSet *by_key, *by_func;
+  PeasPluginInfo *info;
+  gint n_calls = 0, count = 0;
+
+  by_key = peas_extension_set_new_filtered (fixture->engine,
+                                            PEAS_TYPE_ACTIVATABLE,
+                                            "X-Test-Group", "dependencies",
+                                            NULL, NULL, NULL,
+                                            "object", NULL,
+                                            NULL);
+  by_func = peas_extension_set_new_filtered (fixture->engine,
+                                             PEAS_TYPE_ACTIVATABLE,
+                                             NULL, NULL,
+                                             (PeasExtensionSetFilterFunc) not_self_dep,
+                                             &n_calls, NULL,
+                                             "object", NULL,
+                                             NULL);
+
+  test_extension_set_activate (fixture);
+
+  /* The filter is asked about each loaded plugin */
+  g_assert_cmpint (n_calls, ==, G_N_ELEMENTS (loadable_plugins));
+
+  peas_extension_set_foreach (by_key,
+                              (PeasExtensionSetForeachFunc) count_extensions_cb,
+                              &count);
+  g_assert_cmpint (count, ==, 1);
+
+  info = peas_engine_get_plugin_info (fixture->engine, "has-dep");
+  g_assert (peas_extension_set_get_extension (by_key, info) != NULL);
+
+  count = 0;
+  peas_extension_set_foreach (by_func,
+                              (PeasExtensionSetForeachFunc) count_extensions_cb,
+                              &count);
+  g_assert_cmpint (count, ==, G_N_ELEMENTS (loadable_plugins) - 1);
+
+  info = peas_engine_get_plugin_info (fixture->engine, "self-dep");
+  g_assert (peas_extension_set_get_extension (by_func, info) == NULL);
+
+  g_object_unref (by_key);
+  g_object_unref (by_func);
+}
+
+static void
+test_extension_set_shared (TestFixture *fixture)
+{
+  PeasExtensionSet *set1, *set2, *other_set;
+  PeasPluginInfo *info;
+  PeasExtension *exten;
+  GObject *object, *other_object;
+
+  set1 = peas_extension_set_new_shared (fixture->engine, PEAS_TYPE_ACTIVATABLE,
+                                        "object", NULL,
+                                        NULL);
+  set2 = peas_extension_set_new_shared (fixture->engine, PEAS_TYPE_ACTIVATABLE,
+                                        "object", NULL,
+                                        NULL);
+
+  test_extension_set_activate (fixture);
+
+  info = peas_engine_get_plugin_info (fixture->engine, loadable_plugins[0]);
+  exten = peas_extension_set_get_extension (set1, info);
+
+  g_assert (PEAS_IS_ACTIVATABLE (exten));
+  g_assert (peas_extension_set_get_extension (set2, info) == exten);
+
+  /* Unshared sets still have their own extensions */
+  g_assert (peas_extension_set_get_extension (fixture->extension_set,
+                                              info) != exten);
+
+  /* The extension is destroyed with the last set using it */
+  g_object_add_weak_pointer (G_OBJECT (exten), (gpointer *) &exten);
+
+  g_object_unref (set1);
+  g_assert (exten != NULL);
+
+  g_object_unref (set2);
+  g_assert (exten == NULL);
+
+  /* The sets created for the same object share its extension... */
+  object = g_object_new (G_TYPE_OBJECT, NULL);
+  other_object = g_object_new (G_TYPE_OBJECT, NULL);
+
+  set1 = peas_extension_set_new_shared (fixture->engine, PEAS_TYPE_ACTIVATABLE,
+                                        "object", object,
+                                        NULL);
+  set2 = peas_extension_set_new_shared (fixture->engine, PEAS_TYPE_ACTIVATABLE,
+                                        "object", object,
+                                        NULL);
+  other_set = peas_extension_set_new_shared (fixture->engine,
+                                             PEAS_TYPE_ACTIVATABLE,
+                                             "object", other_object,
+                                             NULL);
+
+  exten = peas_extension_set_get_extension (set1, info);
+
+  g_assert (PEAS_IS_ACTIVATABLE (exten));
+  g_assert (peas_extension_set_get_extension (set2, info) == exten);
+
+  /* ...but not with the sets created for another object */
+  g_assert (peas_extension_set_get_extension (other_set, info) != exten);
+
+  g_object_unref (set1);
+  g_object_unref (set2);
+  g_object_unref (other_set);
+  g_object_unref (object);
+  g_object_unref (other_object);
+}
+
+static void
+extensions_changed_cb (PeasExtensionSet *set,
+                       GPtrArray        *infos,
+                       GPtrArray        *extensions,
+                       gint             *n_extensions)
+{
+  g_assert_cmpuint (infos->len, ==, extensions->len);
+  g_assert (PEAS_IS_ACTIVATABLE (g_ptr_array_index (extensions, 0)));
+
+  /* Each emission is checked on its own */
+  g_assert_cmpint (*n_extensions, ==, 0);
+  *n_extensions = extensions->len;
+}
+
+static void
+test_extension_set_batched (TestFixture *fixture)
+{
+  gint n_added = 0, n_removed = 0, i;
+  PeasPluginInfo *info;
+
+  g_signal_connect (fixture->extension_set,
+                    "extensions-added",
+                    G_CALLBACK (extensions_changed_cb),
+                    &n_added);
+  g_signal_connect (fixture->extension_set,
+                    "extensions-removed",
+                    G_CALLBACK (extensions_changed_cb),
+                    &n_removed);
+
+  peas_engine_begin_transaction (fixture->engine);
+  test_extension_set_activate (fixture);
+
+  /* The per-extension signals are still emitted right away */
+  g_assert_cmpint (n_added, ==, 0);
+  peas_engine_commit_transaction (fixture->engine);
+
+  g_assert_cmpint (n_added, ==, G_N_ELEMENTS (loadable_plugins));
+
+  peas_engine_begin_transaction (fixture->engine);
+
+  for (i = G_N_ELEMENTS (loadable_plugins); i > 0; --i)
+    {
+      info = peas_engine_get_plugin_info (fixture->engine,
+                                          loadable_plugins[i - 1]);
+      g_assert (peas_engine_unload_plugin (fixture->engine, info));
+    }
+
+  /* An extension added and removed in the same batch is not reported */
+  info = peas_engine_get_plugin_info (fixture->engine, loadable_plugins[0]);
+  g_assert (peas_engine_load_plugin (fixture->engine, info));
+  g_assert (peas_engine_unload_plugin (fixture->engine, info));
+
+  peas_engine_commit_transaction (fixture->engine);
+
+  g_assert_cmpint (n_removed, ==, G_N_ELEMENTS (loadable_plugins));
+  g_assert_cmpint (fixture->active, ==, 0);
+
+  /* Only one batch was emitted */
+  n_added = 0;
+  while (g_main_context_iteration (NULL, FALSE))
+    ;
+  g_assert_cmpint (n_added, ==, 0);
+}
+
+static void
+test_extension_set_call_modes (TestFixture *fixture)
+{
+  PeasPluginInfo *info;
+  PeasExtensionSet *set;
+  PeasMethod *method;
+  GIArgument return_values[2];
+
+  info = peas_engine_get_plugin_info (fixture->engine, "callable");
+
+  g_assert (info != NULL);
+  g_assert (peas_engine_load_plugin (fixture->engine, info));
+
+  set = peas_extension_set_new (fixture->engine, INTROSPECTION_TYPE_CALLABLE,
+                                NULL);
+  method = peas_method_new (INTROSPECTION_TYPE_CALLABLE, "call_with_return");
+
+  g_assert_cmpuint (peas_extension_set_call_method_full (set, method,
+                                                         PEAS_EXTENSION_SET_CALL_ALL,
+                                                         NULL, NULL, 0), ==, 0);
+
+  g_assert_cmpuint (peas_extension_set_call_method_full (set, method,
+                                                         PEAS_EXTENSION_SET_CALL_FIRST_HANDLED,
+                                                         NULL, return_values, 1), ==, 1);
+  g_assert_cmpstr (return_values[0].v_string, ==, "Hello, World!");
+
+  g_assert_cmpuint (peas_extension_set_call_method_full (set, method,
+                                                         PEAS_EXTENSION_SET_CALL_COLLECT,
+                                                         NULL, return_values,
+                                                         G_N_ELEMENTS (return_values)), ==, 1);
+  g_assert_cmpstr (return_values[0].v_string, ==, "Hello, World!");
+
+  peas_method_unref (method);
+  g_object_unref (set);
+
+  /* Nothing handles a method returning void */
+  test_extension_set_activate (fixture);
+
+  method = peas_method_new (PEAS_TYPE_ACTIVATABLE, "activate");
+
+  g_assert_cmpuint (peas_extension_set_call_method_full (fixture->extension_set,
+                                                         method,
+                                                         PEAS_EXTENSION_SET_CALL_FIRST_HANDLED,
+                                                         NULL, return_values, 1), ==, 0);
+
+  /* ...and there is nothing to collect */
+  if (g_test_trap_fork (0, G_TEST_TRAP_SILENCE_STDOUT | G_TEST_TRAP_SILENCE_STDERR))
+    {
+      peas_extension_set_call_method_full (fixture->extension_set, method,
+                                           PEAS_EXTENSION_SET_CALL_COLLECT,
+                                           NULL, return_values,
+                                           G_N_ELEMENTS (return_values));
+      exit (0);
+    }
+  g_test_trap_assert_failed ();
+
+  peas_method_unref (method);
+}
+
+static void
+test_extension_set_call_generated (TestFixture *fixture)
+{
+  PeasPluginInfo *info;
+  PeasExtensionSet *set;
+  gboolean params[3] = { FALSE, FALSE, FALSE };
+
+  info = peas_engine_get_plugin_info (fixture->engine, "callable");
+
+  g_assert (info != NULL);
+  g_assert (peas_engine_load_plugin (fixture->engine, info));
+
+  set = peas_extension_set_new (fixture->engine, INTROSPECTION_TYPE_CALLABLE,
+                                NULL);
+
+  g_assert (introspection_callable_set_call_call_multi_args (set, &params[0],
+                                                              &params[1],
+                                                              &params[2]));
+  g_assert (params[0] && params[1] && params[2]);
+
+  g_object_unref (set);
+}
+
+typedef struct {
+  gint count;
+  gint n_from_pool;
+} ParallelResults;
+
+static void
+parallel_results_cb (PeasExtensionSet *set,
+                     PeasPluginInfo   *info,
+                     PeasExtension    *exten,
+                     GIArgument       *return_value,
+                     ParallelResults  *results)
+{
+  gchar *thread_name;
+
+  g_assert (peas_plugin_info_is_thread_safe (info));
+
+  /* The extensions return the thread they were called from */
+  thread_name = g_strdup_printf ("%p", (gpointer) g_thread_self ());
+  if (g_strcmp0 (return_value->v_string, thread_name) != 0)
+    results->n_from_pool++;
+  g_free (thread_name);
+
+  results->count++;
+}
+
+static void
+test_extension_set_call_parallel (TestFixture *fixture)
+{
+  const gchar *module_names[] = {
+    "thread-safe-a", "thread-safe-b", "thread-safe-failing"
+  };
+  PeasPluginInfo *info;
+  PeasExtensionSet *set;
+  PeasMethod *method;
+  ParallelResults results = { 0, 0 };
+  GError *error = NULL;
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (module_names); i++)
+    {
+      info = peas_engine_get_plugin_info (fixture->engine, module_names[i]);
+
+      g_assert (info != NULL);
+      g_assert (peas_engine_load_plugin (fixture->engine, info));
+    }
+
+  /* The failing plugin only turns out not to provide its extension
+   * when the lazy set tries to create it */
+  set = peas_extension_set_new_lazy (fixture->engine,
+                                     INTROSPECTION_TYPE_CALLABLE, NULL);
+  method = peas_method_new (INTROSPECTION_TYPE_CALLABLE, "call_with_return");
+
+  g_assert (!peas_extension_set_call_parallel (set, method, NULL,
+                                               (PeasExtensionSetResultFunc) parallel_results_cb,
+                                               &results, &error));
+  g_assert_error (error, PEAS_EXTENSION_SET_ERROR,
+                  PEAS_EXTENSION_SET_ERROR_CALL_FAILED);
+  g_assert (strstr (error->message, "thread-safe-failing") != NULL);
+  g_assert (strstr (error->message, "thread-safe-a") == NULL);
+  g_assert (strstr (error->message, "thread-safe-b") == NULL);
+  g_error_free (error);
+
+  g_assert_cmpint (results.count, ==, 2);
+  g_assert_cmpint (results.n_from_pool, ==, 2);
+
+  peas_method_unref (method);
+  g_object_unref (set);
+}
+
 int
 main (int    argc,
       char **argv)
 {
+  g_thread_init (NULL);
+
   g_test_init (&argc, &argv, NULL);
 
   g_type_init ();
@@ -211,9 +767,21 @@ main (int    argc,
   TEST ("deactivate", deactivate);
 
   TEST ("get-extension", get_extension);
+  TEST ("foreach", foreach);
+  TEST ("foreach-order", foreach_order);
+  TEST ("sort-func", sort_func);
+  TEST ("foreach-unload", foreach_unload);
 
   TEST ("call-valid", call_valid);
   TEST ("call-invalid", call_invalid);
+  TEST ("call-method", call_method);
+  TEST ("lazy", lazy);
+  TEST ("filtered", filtered);
+  TEST ("shared", shared);
+  TEST ("batched", batched);
+  TEST ("call-modes", call_modes);
+  TEST ("call-generated", call_generated);
+  TEST ("call-parallel", call_parallel);
 
 #undef TEST
 
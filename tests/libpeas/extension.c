@@ -27,6 +27,7 @@
 
 #include <glib.h>
 #include <libpeas/peas.h>
+#include <libpeas/peas-introspection.h>
 
 #include "testing/testing.h"
 
@@ -257,6 +258,199 @@ test_extension_call_multi_args (PeasEngine *engine)
   g_object_unref (extension);
 }
 
+static void
+test_extension_call_method (PeasEngine *engine)
+{
+  PeasPluginInfo *info;
+  PeasExtension *extension;
+  PeasMethod *return_method, *multi_args_method;
+  const gchar *return_val = NULL;
+  gboolean params[3] = { FALSE, FALSE, FALSE };
+
+  info = peas_engine_get_plugin_info (engine, "callable");
+
+  g_assert (info != NULL);
+  g_assert (peas_engine_load_plugin (engine, info));
+
+  extension = peas_engine_create_extension (engine, info,
+                                            INTROSPECTION_TYPE_CALLABLE,
+                                            NULL);
+
+  g_assert (INTROSPECTION_IS_CALLABLE (extension));
+
+  return_method = peas_method_new (INTROSPECTION_TYPE_CALLABLE,
+                                   "call_with_return");
+  multi_args_method = peas_method_new (INTROSPECTION_TYPE_CALLABLE,
+                                       "call_multi_args");
+
+  g_assert (return_method != NULL);
+  g_assert (multi_args_method != NULL);
+
+  g_assert (peas_extension_call_method (extension, return_method,
+                                        &return_val));
+  g_assert_cmpstr (return_val, ==, "Hello, World!");
+
+  g_assert (peas_extension_call_method (extension, multi_args_method,
+                                        &params[0], &params[1], &params[2]));
+  g_assert (params[0] && params[1] && params[2]);
+
+  peas_method_unref (multi_args_method);
+  peas_method_unref (return_method);
+  g_object_unref (extension);
+}
+
+static void
+test_extension_call_through_interface (PeasEngine *engine)
+{
+  PeasPluginInfo *info;
+  PeasExtension *extension;
+  gboolean params[3] = { FALSE, FALSE, FALSE };
+
+  info = peas_engine_get_plugin_info (engine, "callable");
+
+  g_assert (info != NULL);
+  g_assert (peas_engine_load_plugin (engine, info));
+
+  extension = peas_engine_create_extension (engine, info,
+                                            INTROSPECTION_TYPE_CALLABLE,
+                                            NULL);
+
+  g_assert (INTROSPECTION_IS_CALLABLE (extension));
+
+  /* The proxy forwards these to the plugin's implementation */
+  g_assert_cmpstr (introspection_callable_call_with_return (INTROSPECTION_CALLABLE (extension)),
+                   ==, "Hello, World!");
+
+  introspection_callable_call_multi_args (INTROSPECTION_CALLABLE (extension),
+                                          &params[0], &params[1], &params[2]);
+  g_assert (params[0] && params[1] && params[2]);
+
+  g_object_unref (extension);
+}
+
+#define N_PERF_CALLS 100000
+
+static void
+test_extension_call_many (PeasEngine *engine)
+{
+  PeasPluginInfo *info;
+  PeasExtension *extension;
+  const gchar *return_val = NULL;
+  gdouble elapsed;
+  guint i;
+
+  info = peas_engine_get_plugin_info (engine, "callable");
+
+  g_assert (info != NULL);
+  g_assert (peas_engine_load_plugin (engine, info));
+
+  extension = peas_engine_create_extension (engine, info,
+                                            INTROSPECTION_TYPE_CALLABLE,
+                                            NULL);
+
+  g_assert (INTROSPECTION_IS_CALLABLE (extension));
+
+  g_test_timer_start ();
+  for (i = 0; i < N_PERF_CALLS; i++)
+    peas_extension_call (extension, "call_with_return", &return_val);
+  elapsed = g_test_timer_elapsed ();
+
+  g_test_minimized_result (elapsed, "Called %u methods in %6.3f seconds",
+                           N_PERF_CALLS, elapsed);
+
+  g_assert_cmpstr (return_val, ==, "Hello, World!");
+
+  g_object_unref (extension);
+}
+
+static void
+test_extension_call_method_many (PeasEngine *engine)
+{
+  PeasPluginInfo *info;
+  PeasExtension *extension;
+  PeasMethod *method;
+  const gchar *return_val = NULL;
+  gdouble elapsed;
+  guint i;
+
+  info = peas_engine_get_plugin_info (engine, "callable");
+
+  g_assert (info != NULL);
+  g_assert (peas_engine_load_plugin (engine, info));
+
+  extension = peas_engine_create_extension (engine, info,
+                                            INTROSPECTION_TYPE_CALLABLE,
+                                            NULL);
+
+  g_assert (INTROSPECTION_IS_CALLABLE (extension));
+
+  method = peas_method_new (INTROSPECTION_TYPE_CALLABLE, "call_with_return");
+  g_assert (method != NULL);
+
+  g_test_timer_start ();
+  for (i = 0; i < N_PERF_CALLS; i++)
+    peas_extension_call_method (extension, method, &return_val);
+  elapsed = g_test_timer_elapsed ();
+
+  g_test_minimized_result (elapsed, "Called %u methods in %6.3f seconds",
+                           N_PERF_CALLS, elapsed);
+
+  g_assert_cmpstr (return_val, ==, "Hello, World!");
+
+  peas_method_unref (method);
+  g_object_unref (extension);
+}
+
+static void
+test_extension_call_vfunc_many (PeasEngine *engine)
+{
+  PeasPluginInfo *info;
+  GObject *instance;
+  const PeasCallPlan *plan;
+  gpointer vtable;
+  GIArgument retval;
+  gdouble invoker_elapsed, vfunc_elapsed;
+  guint i;
+
+  info = peas_engine_get_plugin_info (engine, "callable");
+
+  g_assert (info != NULL);
+  g_assert (peas_engine_load_plugin (engine, info));
+
+  /* Compare the two ways the C loader can call a native implementation */
+  instance = g_object_new (g_type_from_name ("TestingCallablePlugin"), NULL);
+
+  plan = peas_gi_get_call_plan (INTROSPECTION_TYPE_CALLABLE,
+                                "call_with_return");
+  g_assert (plan != NULL);
+  g_assert_cmpint (plan->vfunc_offset, >=, 0);
+
+  vtable = peas_gi_get_vtable (instance, INTROSPECTION_TYPE_CALLABLE);
+  g_assert (vtable != NULL);
+
+  g_test_timer_start ();
+  for (i = 0; i < N_PERF_CALLS; i++)
+    peas_method_apply_plan (instance, plan, NULL, &retval);
+  invoker_elapsed = g_test_timer_elapsed ();
+
+  g_assert_cmpstr (retval.v_string, ==, "Hello, World!");
+  retval.v_string = NULL;
+
+  g_test_timer_start ();
+  for (i = 0; i < N_PERF_CALLS; i++)
+    peas_method_apply_vfunc (instance, vtable, plan, NULL, &retval);
+  vfunc_elapsed = g_test_timer_elapsed ();
+
+  g_assert_cmpstr (retval.v_string, ==, "Hello, World!");
+
+  g_test_minimized_result (vfunc_elapsed,
+                           "Called %u vfuncs in %6.3f seconds "
+                           "(%6.3f seconds through the invoker)",
+                           N_PERF_CALLS, vfunc_elapsed, invoker_elapsed);
+
+  g_object_unref (instance);
+}
+
 int
 main (int    argc,
       char **argv)
@@ -278,6 +472,15 @@ main (int    argc,
   TEST ("call-with-return", call_with_return);
   TEST ("call-single-arg", call_single_arg);
   TEST ("call-multi-args", call_multi_args);
+  TEST ("call-method", call_method);
+  TEST ("call-through-interface", call_through_interface);
+
+  if (g_test_perf ())
+    {
+      TEST ("call-many", call_many);
+      TEST ("call-method-many", call_method_many);
+      TEST ("call-vfunc-many", call_vfunc_many);
+    }
 
 #undef TEST
 
@@ -0,0 +1,261 @@
+/*
+ * plugin-cache.c
+ * This file is part of libpeas
+ *
+ * Copyright (C) 2026 - agent
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Library General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <utime.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <libpeas/peas.h>
+
+#include "testing/testing.h"
+
+/* Every plugin file and search path is given an mtime in the past,
+ * the cache only trusts entries older than the cache itself.
+ */
+#define OLD_MTIME_DELTA 100
+
+typedef struct _TestFixture TestFixture;
+
+struct _TestFixture {
+  PeasEngine *engine;
+  gchar *dir;
+  gchar *cache_file;
+  time_t mtime;
+};
+
+static void
+set_mtime (const gchar *filename,
+           time_t       mtime)
+{
+  struct utimbuf buf;
+
+  buf.actime = mtime;
+  buf.modtime = mtime;
+
+  g_assert_cmpint (g_utime (filename, &buf), ==, 0);
+}
+
+/* Rewriting the file in place keeps its inode, so only
+ * the mtime and the size can tell the cache that it changed.
+ */
+static void
+write_plugin (TestFixture *fixture,
+              const gchar *module_name,
+              time_t       mtime)
+{
+  gchar *filename;
+  FILE *file;
+
+  filename = g_build_filename (fixture->dir, "cache-test.plugin", NULL);
+
+  file = fopen (filename, "w");
+  g_assert (file != NULL);
+
+  fprintf (file,
+           "[Plugin]\n"
+           "Module=%s\n"
+           "Name=Cache Test\n"
+           "IAge=2\n", module_name);
+
+  g_assert_cmpint (fclose (file), ==, 0);
+
+  set_mtime (filename, mtime);
+  set_mtime (fixture->dir, fixture->mtime);
+
+  g_free (filename);
+}
+
+static void
+test_setup (TestFixture   *fixture,
+            gconstpointer  data)
+{
+  gchar *checksum;
+  gchar *basename;
+
+  fixture->engine = testing_engine_new ();
+  fixture->mtime = time (NULL) - OLD_MTIME_DELTA;
+
+  fixture->dir = g_strdup_printf ("%s/libpeas-cache-%lu-%s",
+                                  g_get_tmp_dir (), (gulong) getpid (),
+                                  (const gchar *) data);
+  g_assert_cmpint (g_mkdir_with_parents (fixture->dir, 0755), ==, 0);
+
+  checksum = g_compute_checksum_for_string (G_CHECKSUM_MD5, fixture->dir, -1);
+  basename = g_strconcat (checksum, ".cache", NULL);
+  fixture->cache_file = g_build_filename (g_getenv ("PEAS_PLUGIN_CACHE_DIR"),
+                                          basename, NULL);
+
+  g_free (basename);
+  g_free (checksum);
+}
+
+static void
+test_teardown (TestFixture   *fixture,
+               gconstpointer  data)
+{
+  gchar *filename;
+
+  filename = g_build_filename (fixture->dir, "cache-test.plugin", NULL);
+  g_unlink (filename);
+  g_free (filename);
+
+  g_rmdir (fixture->dir);
+  g_unlink (fixture->cache_file);
+
+  g_free (fixture->cache_file);
+  g_free (fixture->dir);
+
+  testing_engine_free (fixture->engine);
+}
+
+/* The first scan parses the plugin and writes the cache */
+static void
+scan_first (TestFixture *fixture,
+            const gchar *module_name)
+{
+  write_plugin (fixture, module_name, fixture->mtime);
+  peas_engine_add_search_path (fixture->engine, fixture->dir, NULL);
+
+  g_assert (peas_engine_get_plugin_info (fixture->engine, module_name) != NULL);
+  g_assert (g_file_test (fixture->cache_file, G_FILE_TEST_IS_REGULAR));
+}
+
+static void
+test_plugin_cache_round_trip (TestFixture   *fixture,
+                              gconstpointer  data)
+{
+  scan_first (fixture, "cache-round-trip-a");
+
+  /* Same inode, size and mtime: the plugin is built from the cache,
+   * so the new module name is never seen.
+   */
+  write_plugin (fixture, "cache-round-trip-b", fixture->mtime);
+  peas_engine_rescan_plugins (fixture->engine);
+
+  g_assert (peas_engine_get_plugin_info (fixture->engine,
+                                         "cache-round-trip-a") != NULL);
+  g_assert (peas_engine_get_plugin_info (fixture->engine,
+                                         "cache-round-trip-b") == NULL);
+}
+
+static void
+test_plugin_cache_changed_mtime (TestFixture   *fixture,
+                                 gconstpointer  data)
+{
+  scan_first (fixture, "cache-mtime-a");
+
+  write_plugin (fixture, "cache-mtime-b", fixture->mtime + 1);
+  peas_engine_rescan_plugins (fixture->engine);
+
+  g_assert (peas_engine_get_plugin_info (fixture->engine,
+                                         "cache-mtime-b") != NULL);
+}
+
+static void
+test_plugin_cache_changed_size (TestFixture   *fixture,
+                                gconstpointer  data)
+{
+  scan_first (fixture, "cache-size-a");
+
+  write_plugin (fixture, "cache-size-longer", fixture->mtime);
+  peas_engine_rescan_plugins (fixture->engine);
+
+  g_assert (peas_engine_get_plugin_info (fixture->engine,
+                                         "cache-size-longer") != NULL);
+}
+
+static void
+test_plugin_cache_corrupt (TestFixture   *fixture,
+                           gconstpointer  data)
+{
+  scan_first (fixture, "cache-corrupt-a");
+
+  g_assert (g_file_set_contents (fixture->cache_file,
+                                 "This is not a plugin cache", -1, NULL));
+
+  write_plugin (fixture, "cache-corrupt-b", fixture->mtime);
+  peas_engine_rescan_plugins (fixture->engine);
+
+  g_assert (peas_engine_get_plugin_info (fixture->engine,
+                                         "cache-corrupt-b") != NULL);
+}
+
+static void
+test_plugin_cache_old_version (TestFixture   *fixture,
+                               gconstpointer  data)
+{
+  gchar *contents;
+  gsize length;
+  guint32 version;
+
+  scan_first (fixture, "cache-version-a");
+
+  /* The version is the first member of the cache */
+  g_assert (g_file_get_contents (fixture->cache_file,
+                                 &contents, &length, NULL));
+  g_assert_cmpuint (length, >=, sizeof (guint32));
+
+  memcpy (&version, contents, sizeof (guint32));
+  g_assert_cmpuint (version, >, 1);
+
+  version--;
+  memcpy (contents, &version, sizeof (guint32));
+
+  g_assert (g_file_set_contents (fixture->cache_file, contents, length, NULL));
+  g_free (contents);
+
+  write_plugin (fixture, "cache-version-b", fixture->mtime);
+  peas_engine_rescan_plugins (fixture->engine);
+
+  g_assert (peas_engine_get_plugin_info (fixture->engine,
+                                         "cache-version-b") != NULL);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_type_init ();
+
+#define TEST(path, ftest) \
+  g_test_add ("/plugin-cache/" path, TestFixture, path, \
+              test_setup, test_plugin_cache_##ftest, test_teardown)
+
+  TEST ("round-trip", round_trip);
+  TEST ("changed-mtime", changed_mtime);
+  TEST ("changed-size", changed_size);
+  TEST ("corrupt", corrupt);
+  TEST ("old-version", old_version);
+
+#undef TEST
+
+  return g_test_run ();
+}
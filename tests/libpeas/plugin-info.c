@@ -62,12 +62,15 @@ test_plugin_info_verify_full_info (PeasEngine *engine)
 {
   PeasPluginInfo *info;
   const gchar **authors;
+  const gchar **extension_types;
 
   info = peas_engine_get_plugin_info (engine, "full-info");
 
   g_assert (!peas_plugin_info_is_loaded (info));
   g_assert (peas_plugin_info_is_available (info));
   g_assert (peas_plugin_info_is_builtin (info));
+  g_assert (peas_plugin_info_is_thread_safe (info));
+  g_assert_cmpint (peas_plugin_info_get_priority (info), ==, -5);
 
   g_assert_cmpstr (peas_plugin_info_get_module_name (info), ==, "full-info");
   g_assert (g_str_has_suffix (peas_plugin_info_get_module_dir (info), "/tests/plugins"));
@@ -89,6 +92,11 @@ test_plugin_info_verify_full_info (PeasEngine *engine)
   authors = peas_plugin_info_get_authors (info);
   g_assert (authors != NULL && authors[1] == NULL);
   g_assert_cmpstr (authors[0], ==, "Garrett Regier");
+
+  extension_types = peas_plugin_info_get_extension_types (info);
+  g_assert (extension_types != NULL && extension_types[2] == NULL);
+  g_assert_cmpstr (extension_types[0], ==, "PeasActivatable");
+  g_assert_cmpstr (extension_types[1], ==, "IntrospectionCallable");
 }
 
 static void
@@ -101,6 +109,8 @@ test_plugin_info_verify_min_info (PeasEngine *engine)
   g_assert (!peas_plugin_info_is_loaded (info));
   g_assert (peas_plugin_info_is_available (info));
   g_assert (!peas_plugin_info_is_builtin (info));
+  g_assert (!peas_plugin_info_is_thread_safe (info));
+  g_assert_cmpint (peas_plugin_info_get_priority (info), ==, 0);
 
   g_assert_cmpstr (peas_plugin_info_get_module_name (info), ==, "min-info");
   g_assert (g_str_has_suffix (peas_plugin_info_get_module_dir (info), "/tests/plugins"));
@@ -118,6 +128,7 @@ test_plugin_info_verify_min_info (PeasEngine *engine)
   g_assert_cmpint (peas_plugin_info_get_iage (info), ==, 2);
 
   g_assert (peas_plugin_info_get_authors (info) == NULL);
+  g_assert (peas_plugin_info_get_extension_types (info) == NULL);
 }
 
 static void
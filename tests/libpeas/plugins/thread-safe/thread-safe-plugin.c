@@ -0,0 +1,93 @@
+/*
+ * thread-safe-plugin.c
+ * This file is part of libpeas
+ *
+ * Copyright (C) 2026 - agent
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Library General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <glib.h>
+#include <glib-object.h>
+#include <gmodule.h>
+
+#include <libpeas/peas.h>
+
+#include "introspection-callable.h"
+
+/* The thread-safe modules are all built from this file, each registering
+ * its extension type under its own THREAD_SAFE_TYPE_NAME. A module built
+ * without it provides no extension at all. */
+#ifdef THREAD_SAFE_TYPE_NAME
+
+/* Tells the caller which thread the extension was called from */
+static const gchar *
+thread_safe_plugin_call_with_return (IntrospectionCallable *callable)
+{
+  gchar *thread_name;
+  const gchar *interned;
+
+  thread_name = g_strdup_printf ("%p", (gpointer) g_thread_self ());
+  interned = g_intern_string (thread_name);
+  g_free (thread_name);
+
+  return interned;
+}
+
+static void
+introspection_callable_iface_init (IntrospectionCallableInterface *iface)
+{
+  iface->call_with_return = thread_safe_plugin_call_with_return;
+}
+
+G_MODULE_EXPORT void
+peas_register_types (PeasObjectModule *module)
+{
+  const GTypeInfo type_info = {
+    sizeof (PeasExtensionBaseClass),
+    NULL, NULL, NULL, NULL, NULL,
+    sizeof (PeasExtensionBase),
+    0, NULL, NULL
+  };
+  const GInterfaceInfo iface_info = {
+    (GInterfaceInitFunc) introspection_callable_iface_init,
+    NULL, NULL
+  };
+  GType type;
+
+  type = g_type_module_register_type (G_TYPE_MODULE (module),
+                                      PEAS_TYPE_EXTENSION_BASE,
+                                      THREAD_SAFE_TYPE_NAME,
+                                      &type_info, 0);
+  g_type_module_add_interface (G_TYPE_MODULE (module), type,
+                               INTROSPECTION_TYPE_CALLABLE, &iface_info);
+
+  peas_object_module_register_extension_type (module,
+                                              INTROSPECTION_TYPE_CALLABLE,
+                                              type);
+}
+
+#else
+
+G_MODULE_EXPORT void
+peas_register_types (PeasObjectModule *module)
+{
+}
+
+#endif
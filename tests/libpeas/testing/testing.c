@@ -26,12 +26,15 @@
 #include <stdlib.h>
 
 #include <glib.h>
+#include <glib/gstdio.h>
 #include <girepository.h>
 
 #include "libpeas/peas-plugin-info-priv.h"
 
 #include "testing.h"
 
+#define PLUGIN_CACHE_DIR BUILDDIR "/tests/libpeas/plugin-cache"
+
 static GLogFunc default_log_func;
 
 /* These are warning that just have to happen for testing
@@ -86,6 +89,31 @@ out:
   abort ();
 }
 
+/* The cache directory outlives the test run,
+ * so a stale cache must not leak into the next one.
+ */
+static void
+clear_plugin_cache (void)
+{
+  GDir *dir;
+  const gchar *basename;
+
+  dir = g_dir_open (PLUGIN_CACHE_DIR, 0, NULL);
+  if (dir == NULL)
+    return;
+
+  while ((basename = g_dir_read_name (dir)) != NULL)
+    {
+      gchar *filename;
+
+      filename = g_build_filename (PLUGIN_CACHE_DIR, basename, NULL);
+      g_unlink (filename);
+      g_free (filename);
+    }
+
+  g_dir_close (dir);
+}
+
 PeasEngine *
 testing_engine_new (void)
 {
@@ -93,6 +121,8 @@ testing_engine_new (void)
   GError *error = NULL;
   static gboolean initialized = FALSE;
 
+  clear_plugin_cache ();
+
   if (initialized)
     return peas_engine_get_default ();
 
@@ -104,6 +134,7 @@ testing_engine_new (void)
   g_irepository_prepend_search_path (BUILDDIR "/libpeas");
 
   g_setenv ("PEAS_PLUGIN_LOADERS_DIR", BUILDDIR "/loaders", TRUE);
+  g_setenv ("PEAS_PLUGIN_CACHE_DIR", PLUGIN_CACHE_DIR, TRUE);
 
   g_irepository_require (g_irepository_get_default (), "Peas", "1.0", 0, &error);
   g_assert_no_error (error);
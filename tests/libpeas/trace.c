@@ -0,0 +1,300 @@
+/*
+ * trace.c
+ * This file is part of libpeas
+ *
+ * Copyright (C) 2026 - agent
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Library General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+#include <unistd.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <libpeas/peas.h>
+
+#include "testing/testing.h"
+
+typedef struct _TestFixture TestFixture;
+
+struct _TestFixture {
+  PeasEngine *engine;
+};
+
+static gchar *trace_filename = NULL;
+
+static void
+test_setup (TestFixture   *fixture,
+            gconstpointer  data)
+{
+  fixture->engine = testing_engine_new ();
+}
+
+static void
+test_teardown (TestFixture   *fixture,
+               gconstpointer  data)
+{
+  testing_engine_free (fixture->engine);
+}
+
+static void
+test_runner (TestFixture   *fixture,
+             gconstpointer  data)
+{
+  ((void (*) (PeasEngine *engine)) data) (fixture->engine);
+}
+
+/* A small JSON parser, which only checks the syntax and
+ * counts the objects found directly in the top-level array.
+ */
+static gboolean parse_value (const gchar **p);
+
+static void
+skip_space (const gchar **p)
+{
+  while (**p == ' ' || **p == '\t' || **p == '\n' || **p == '\r')
+    (*p)++;
+}
+
+static gboolean
+parse_string (const gchar **p)
+{
+  if (**p != '"')
+    return FALSE;
+
+  for ((*p)++; **p != '"'; (*p)++)
+    {
+      if ((guchar) **p < 0x20)
+        return FALSE;
+
+      if (**p != '\\')
+        continue;
+
+      (*p)++;
+
+      if (**p == 'u')
+        {
+          gint i;
+
+          for (i = 0; i < 4; i++)
+            {
+              (*p)++;
+              if (!g_ascii_isxdigit (**p))
+                return FALSE;
+            }
+        }
+      else if (strchr ("\"\\/bfnrt", **p) == NULL || **p == '\0')
+        {
+          return FALSE;
+        }
+    }
+
+  (*p)++;
+  return TRUE;
+}
+
+static gboolean
+parse_number (const gchar **p)
+{
+  const gchar *start = *p;
+
+  if (**p == '-')
+    (*p)++;
+
+  while (g_ascii_isdigit (**p))
+    (*p)++;
+
+  if (**p == '.')
+    {
+      (*p)++;
+      while (g_ascii_isdigit (**p))
+        (*p)++;
+    }
+
+  if (**p == 'e' || **p == 'E')
+    {
+      (*p)++;
+      if (**p == '+' || **p == '-')
+        (*p)++;
+      while (g_ascii_isdigit (**p))
+        (*p)++;
+    }
+
+  return *p != start && g_ascii_isdigit ((*p)[-1]);
+}
+
+static gboolean
+parse_members (const gchar **p,
+               gchar         close,
+               gboolean      with_keys,
+               guint        *n_objects)
+{
+  (*p)++;
+  skip_space (p);
+
+  if (**p == close)
+    {
+      (*p)++;
+      return TRUE;
+    }
+
+  while (TRUE)
+    {
+      if (with_keys)
+        {
+          if (!parse_string (p))
+            return FALSE;
+
+          skip_space (p);
+          if (**p != ':')
+            return FALSE;
+
+          (*p)++;
+          skip_space (p);
+        }
+
+      if (n_objects != NULL && **p == '{')
+        (*n_objects)++;
+
+      if (!parse_value (p))
+        return FALSE;
+
+      skip_space (p);
+
+      if (**p == close)
+        {
+          (*p)++;
+          return TRUE;
+        }
+
+      if (**p != ',')
+        return FALSE;
+
+      (*p)++;
+      skip_space (p);
+    }
+}
+
+static gboolean
+parse_value (const gchar **p)
+{
+  switch (**p)
+    {
+    case '{':
+      return parse_members (p, '}', TRUE, NULL);
+    case '[':
+      return parse_members (p, ']', FALSE, NULL);
+    case '"':
+      return parse_string (p);
+    }
+
+  if (g_str_has_prefix (*p, "true"))
+    {
+      *p += 4;
+      return TRUE;
+    }
+
+  if (g_str_has_prefix (*p, "false"))
+    {
+      *p += 5;
+      return TRUE;
+    }
+
+  if (g_str_has_prefix (*p, "null"))
+    {
+      *p += 4;
+      return TRUE;
+    }
+
+  return parse_number (p);
+}
+
+static guint
+parse_trace (const gchar *contents)
+{
+  const gchar *p = contents;
+  guint n_events = 0;
+
+  skip_space (&p);
+  g_assert (*p == '[');
+  g_assert (parse_members (&p, ']', FALSE, &n_events));
+
+  skip_space (&p);
+  g_assert (*p == '\0');
+
+  return n_events;
+}
+
+static void
+test_trace_valid_json (PeasEngine *engine)
+{
+  PeasPluginInfo *info;
+  gchar *contents;
+  guint n_events, n_more_events;
+
+  /* Scanning the plugins already wrote events */
+  g_assert (g_file_get_contents (trace_filename, &contents, NULL, NULL));
+  n_events = parse_trace (contents);
+  g_assert_cmpuint (n_events, >, 0);
+  g_assert (strstr (contents, "\"load_dir_real\"") != NULL);
+  g_free (contents);
+
+  info = peas_engine_get_plugin_info (engine, "loadable");
+  g_assert (peas_engine_load_plugin (engine, info));
+  g_assert (peas_engine_unload_plugin (engine, info));
+
+  /* The file is still valid after more events */
+  g_assert (g_file_get_contents (trace_filename, &contents, NULL, NULL));
+  n_more_events = parse_trace (contents);
+  g_assert_cmpuint (n_more_events, >, n_events);
+  g_free (contents);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  gint retval;
+
+  g_test_init (&argc, &argv, NULL);
+
+  g_type_init ();
+
+  /* Must be set before the engine is created */
+  trace_filename = g_strdup_printf ("%s/libpeas-trace-%lu.json",
+                                    g_get_tmp_dir (), (gulong) getpid ());
+  g_setenv ("PEAS_TRACE", trace_filename, TRUE);
+
+#define TEST(path, ftest) \
+  g_test_add ("/trace/" path, TestFixture, \
+              (gpointer) test_trace_##ftest, \
+              test_setup, test_runner, test_teardown)
+
+  TEST ("valid-json", valid_json);
+
+#undef TEST
+
+  retval = g_test_run ();
+
+  g_unlink (trace_filename);
+  g_free (trace_filename);
+
+  return retval;
+}
@@ -0,0 +1,690 @@
+/*
+ * peas-codegen.c
+ * This file is part of libpeas
+ *
+ * Copyright (C) 2026 - agent
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Library General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Generates typed wrappers calling the methods of an interface on all the
+ * extensions of a PeasExtensionSet, from the .gir of the interface:
+ *
+ *   peas-codegen --interface=Callable --include=my-callable.h \
+ *                --output=callable-wrappers My-1.0.gir
+ *
+ * writes callable-wrappers.h and callable-wrappers.c with, for each method
+ * wrapping a vfunc and returning nothing:
+ *
+ *   gboolean my_callable_set_call_method_name (PeasExtensionSet *set, ...);
+ *
+ * For the extensions with a native instance, as the C loader creates, the
+ * wrappers call the vfunc of the instance directly. The other extensions
+ * are called through a PeasMethod resolved on first use.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+
+typedef struct {
+  gchar *name;
+  gchar *type_name;
+  gchar *c_type;
+  gboolean is_out;
+} Param;
+
+typedef struct {
+  gchar *name;
+  GPtrArray *params;
+  gboolean unsupported;
+} Method;
+
+typedef struct {
+  const gchar *interface_name;
+
+  gboolean found;
+  gchar *c_type;
+  gchar *get_type;
+  gchar *struct_c_type;
+  GPtrArray *methods;
+
+  /* Maps the methods invoking a vfunc to the name of the vfunc */
+  GHashTable *invokers;
+
+  /* Parser state */
+  gboolean in_interface;
+  Method *method;
+  Param *param;
+  gboolean in_return_value;
+  gint type_depth;
+} Interface;
+
+static gchar *interface_name = NULL;
+static gchar *prefix = NULL;
+static gchar *output = NULL;
+static gchar **includes = NULL;
+static gchar **gir_files = NULL;
+
+static GOptionEntry options[] = {
+  { "interface", 'i', 0, G_OPTION_ARG_STRING, &interface_name,
+    "Name of the interface in the .gir", "NAME" },
+  { "prefix", 'p', 0, G_OPTION_ARG_STRING, &prefix,
+    "Prefix of the generated functions", "PREFIX" },
+  { "include", 'I', 0, G_OPTION_ARG_STRING_ARRAY, &includes,
+    "Header declaring the interface", "HEADER" },
+  { "output", 'o', 0, G_OPTION_ARG_FILENAME, &output,
+    "Base name of the generated files", "BASENAME" },
+  { G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_FILENAME_ARRAY, &gir_files,
+    NULL, "GIR-FILE" },
+  { NULL }
+};
+
+static void
+param_free (Param *param)
+{
+  g_free (param->name);
+  g_free (param->type_name);
+  g_free (param->c_type);
+  g_free (param);
+}
+
+static void
+method_free (Method *method)
+{
+  g_free (method->name);
+  g_ptr_array_free (method->params, TRUE);
+  g_free (method);
+}
+
+static const gchar *
+lookup_attribute (const gchar **names,
+                  const gchar **values,
+                  const gchar  *name)
+{
+  guint i;
+
+  for (i = 0; names[i] != NULL; i++)
+    {
+      if (strcmp (names[i], name) == 0)
+        return values[i];
+    }
+
+  return NULL;
+}
+
+static void
+start_element (GMarkupParseContext  *context,
+               const gchar          *element_name,
+               const gchar         **attribute_names,
+               const gchar         **attribute_values,
+               gpointer              user_data,
+               GError              **error)
+{
+  Interface *iface = (Interface *) user_data;
+
+  if (strcmp (element_name, "record") == 0)
+    {
+      const gchar *struct_for;
+
+      struct_for = lookup_attribute (attribute_names, attribute_values,
+                                     "glib:is-gtype-struct-for");
+      if (g_strcmp0 (struct_for, iface->interface_name) == 0)
+        iface->struct_c_type = g_strdup (lookup_attribute (attribute_names,
+                                                           attribute_values,
+                                                           "c:type"));
+      return;
+    }
+
+  if (strcmp (element_name, "interface") == 0)
+    {
+      const gchar *name;
+
+      name = lookup_attribute (attribute_names, attribute_values, "name");
+      if (g_strcmp0 (name, iface->interface_name) != 0)
+        return;
+
+      iface->found = TRUE;
+      iface->in_interface = TRUE;
+      iface->c_type = g_strdup (lookup_attribute (attribute_names,
+                                                  attribute_values,
+                                                  "c:type"));
+      iface->get_type = g_strdup (lookup_attribute (attribute_names,
+                                                    attribute_values,
+                                                    "glib:get-type"));
+      return;
+    }
+
+  if (!iface->in_interface)
+    return;
+
+  if (strcmp (element_name, "virtual-method") == 0)
+    {
+      const gchar *invoker;
+
+      invoker = lookup_attribute (attribute_names, attribute_values,
+                                  "invoker");
+      if (invoker != NULL)
+        g_hash_table_insert (iface->invokers, g_strdup (invoker),
+                             g_strdup (lookup_attribute (attribute_names,
+                                                         attribute_values,
+                                                         "name")));
+    }
+  else if (strcmp (element_name, "method") == 0)
+    {
+      iface->method = g_new0 (Method, 1);
+      iface->method->name = g_strdup (lookup_attribute (attribute_names,
+                                                        attribute_values,
+                                                        "name"));
+      iface->method->params = g_ptr_array_new_with_free_func ((GDestroyNotify) param_free);
+
+      /* libpeas can't report errors to the caller of a set */
+      if (g_strcmp0 (lookup_attribute (attribute_names, attribute_values,
+                                       "throws"), "1") == 0)
+        iface->method->unsupported = TRUE;
+    }
+  else if (iface->method == NULL)
+    {
+      return;
+    }
+  else if (strcmp (element_name, "parameter") == 0)
+    {
+      const gchar *direction;
+
+      direction = lookup_attribute (attribute_names, attribute_values,
+                                    "direction");
+
+      iface->param = g_new0 (Param, 1);
+      iface->param->name = g_strdup (lookup_attribute (attribute_names,
+                                                       attribute_values,
+                                                       "name"));
+      iface->param->is_out = direction != NULL && strcmp (direction, "in") != 0;
+    }
+  else if (strcmp (element_name, "return-value") == 0)
+    {
+      iface->in_return_value = TRUE;
+    }
+  else if (strcmp (element_name, "varargs") == 0)
+    {
+      iface->method->unsupported = TRUE;
+    }
+  else if (strcmp (element_name, "type") == 0 ||
+           strcmp (element_name, "array") == 0)
+    {
+      const gchar *c_type, *type_name;
+
+      /* Only the outermost type matters, not the element types */
+      if (iface->type_depth++ > 0)
+        return;
+
+      c_type = lookup_attribute (attribute_names, attribute_values, "c:type");
+      type_name = lookup_attribute (attribute_names, attribute_values, "name");
+
+      if (iface->param != NULL)
+        {
+          iface->param->c_type = g_strdup (c_type);
+          iface->param->type_name = g_strdup (type_name);
+        }
+
+      /* The results of a set call could not be given back to the caller,
+       * and the owned ones would be leaked */
+      if (iface->in_return_value && g_strcmp0 (type_name, "none") != 0)
+        iface->method->unsupported = TRUE;
+    }
+}
+
+static void
+end_element (GMarkupParseContext  *context,
+             const gchar          *element_name,
+             gpointer              user_data,
+             GError              **error)
+{
+  Interface *iface = (Interface *) user_data;
+
+  if (!iface->in_interface)
+    return;
+
+  if (strcmp (element_name, "interface") == 0)
+    {
+      iface->in_interface = FALSE;
+    }
+  else if (strcmp (element_name, "method") == 0 && iface->method != NULL)
+    {
+      g_ptr_array_add (iface->methods, iface->method);
+      iface->method = NULL;
+    }
+  else if (strcmp (element_name, "return-value") == 0)
+    {
+      iface->in_return_value = FALSE;
+    }
+  else if (strcmp (element_name, "parameter") == 0 && iface->param != NULL)
+    {
+      if (iface->param->c_type == NULL)
+        iface->method->unsupported = TRUE;
+
+      g_ptr_array_add (iface->method->params, iface->param);
+      iface->param = NULL;
+    }
+  else if (iface->method != NULL &&
+           (strcmp (element_name, "type") == 0 ||
+            strcmp (element_name, "array") == 0))
+    {
+      iface->type_depth--;
+    }
+}
+
+static gboolean
+parse_gir (const gchar  *filename,
+           Interface    *iface,
+           GError      **error)
+{
+  GMarkupParser parser = { start_element, end_element, NULL, NULL, NULL };
+  GMarkupParseContext *context;
+  gchar *contents;
+  gsize length;
+  gboolean ret;
+
+  if (!g_file_get_contents (filename, &contents, &length, error))
+    return FALSE;
+
+  context = g_markup_parse_context_new (&parser, 0, iface, NULL);
+  ret = g_markup_parse_context_parse (context, contents, length, error) &&
+        g_markup_parse_context_end_parse (context, error);
+
+  g_markup_parse_context_free (context);
+  g_free (contents);
+
+  return ret;
+}
+
+/* The member of GIArgument holding an in argument of the given type */
+static const gchar *
+argument_member (const Param *param)
+{
+  static const gchar *members[][2] = {
+    { "gboolean", "v_boolean" },
+    { "gchar", "v_int8" },
+    { "guchar", "v_uint8" },
+    { "gint8", "v_int8" },
+    { "guint8", "v_uint8" },
+    { "gint16", "v_int16" },
+    { "guint16", "v_uint16" },
+    { "gint32", "v_int32" },
+    { "guint32", "v_uint32" },
+    { "gint64", "v_int64" },
+    { "guint64", "v_uint64" },
+    { "gshort", "v_short" },
+    { "gushort", "v_ushort" },
+    { "gint", "v_int" },
+    { "guint", "v_uint" },
+    { "glong", "v_long" },
+    { "gulong", "v_ulong" },
+    { "gssize", "v_ssize" },
+    { "gsize", "v_size" },
+    { "gfloat", "v_float" },
+    { "gdouble", "v_double" },
+    { "gunichar", "v_uint32" },
+    { "GType", "v_size" },
+    { "gpointer", "v_pointer" },
+    { "gconstpointer", "v_pointer" },
+    { "utf8", "v_string" },
+    { "filename", "v_string" }
+  };
+  guint i;
+
+  if (param->is_out || strchr (param->c_type, '*') != NULL)
+    {
+      if (g_strcmp0 (param->type_name, "utf8") == 0 ||
+          g_strcmp0 (param->type_name, "filename") == 0)
+        return param->is_out ? "v_pointer" : "v_string";
+
+      return "v_pointer";
+    }
+
+  for (i = 0; i < G_N_ELEMENTS (members); i++)
+    {
+      if (g_strcmp0 (param->type_name, members[i][0]) == 0)
+        return members[i][1];
+    }
+
+  /* Enumerations and flags */
+  return "v_int";
+}
+
+static void
+append_parameters (GString      *str,
+                   const Method *method,
+                   guint         indent)
+{
+  guint i;
+
+  g_string_append (str, "(PeasExtensionSet *set");
+
+  for (i = 0; i < method->params->len; i++)
+    {
+      const Param *param = g_ptr_array_index (method->params, i);
+
+      g_string_append_printf (str, ",\n%*s%s %s", indent + 1, "",
+                              param->c_type, param->name);
+    }
+
+  g_string_append (str, ")");
+}
+
+static void
+generate_wrapper (const Interface *iface,
+                  const Method    *method,
+                  const gchar     *vfunc_name,
+                  GString         *header,
+                  GString         *source)
+{
+  gchar *function_name;
+  guint i;
+
+  function_name = g_strdup_printf ("%s_set_call_%s", prefix, method->name);
+
+  g_string_append_printf (header, "gboolean %s ", function_name);
+  append_parameters (header, method, strlen ("gboolean ") +
+                                     strlen (function_name) + 1);
+  g_string_append (header, ";\n");
+
+  /* The arguments are passed to each extension through this structure */
+  g_string_append_printf (source, "struct %s_data {\n"
+                                  "  gboolean ret;\n", function_name);
+
+  for (i = 0; i < method->params->len; i++)
+    {
+      const Param *param = g_ptr_array_index (method->params, i);
+
+      g_string_append_printf (source, "  %s %s;\n",
+                              param->c_type, param->name);
+    }
+
+  g_string_append (source, "};\n\n");
+
+  /* Calls the vfunc of native instances directly, and only resolves
+   * the method when an extension has no native instance */
+  g_string_append_printf (source,
+                          "static void\n"
+                          "%s_cb (PeasExtensionSet *set,\n"
+                          "%*sPeasPluginInfo   *info,\n"
+                          "%*sPeasExtension    *exten,\n"
+                          "%*sgpointer          user_data)\n"
+                          "{\n"
+                          "  static volatile gpointer method = NULL;\n"
+                          "  struct %s_data *data = user_data;\n"
+                          "  GObject *native;\n",
+                          function_name,
+                          (gint) strlen (function_name) + 5, "",
+                          (gint) strlen (function_name) + 5, "",
+                          (gint) strlen (function_name) + 5, "",
+                          function_name);
+
+  if (method->params->len > 0)
+    g_string_append_printf (source, "  GIArgument args[%u];\n",
+                            method->params->len);
+  else
+    g_string_append (source, "  GIArgument *args = NULL;\n");
+
+  g_string_append_printf (source,
+                          "  GIArgument return_value;\n\n"
+                          "  native = peas_extension_get_native (exten, NULL);\n\n"
+                          "  if (native != NULL)\n"
+                          "    {\n"
+                          "      %s *iface;\n\n"
+                          "      iface = G_TYPE_INSTANCE_GET_INTERFACE (native, %s (), %s);\n\n"
+                          "      if (iface->%s != NULL)\n"
+                          "        {\n"
+                          "          iface->%s ((%s *) native",
+                          iface->struct_c_type, iface->get_type,
+                          iface->struct_c_type, vfunc_name, vfunc_name,
+                          iface->c_type);
+
+  for (i = 0; i < method->params->len; i++)
+    {
+      const Param *param = g_ptr_array_index (method->params, i);
+
+      g_string_append_printf (source, ", data->%s", param->name);
+    }
+
+  g_string_append_printf (source,
+                          ");\n"
+                          "          return;\n"
+                          "        }\n"
+                          "    }\n\n"
+                          "  if (g_atomic_pointer_get (&method) == NULL)\n"
+                          "    {\n"
+                          "      PeasMethod *new_method;\n\n"
+                          "      /* Resolved again by the next call if it failed */\n"
+                          "      new_method = peas_method_new (%s (), \"%s\");\n"
+                          "      if (new_method == NULL)\n"
+                          "        {\n"
+                          "          data->ret = FALSE;\n"
+                          "          return;\n"
+                          "        }\n\n"
+                          "      if (!g_atomic_pointer_compare_and_exchange (&method, NULL,\n"
+                          "                                                  new_method))\n"
+                          "        peas_method_unref (new_method);\n"
+                          "    }\n\n",
+                          iface->get_type, method->name);
+
+  for (i = 0; i < method->params->len; i++)
+    {
+      const Param *param = g_ptr_array_index (method->params, i);
+
+      g_string_append_printf (source, "  args[%u].%s = %sdata->%s;\n", i,
+                              argument_member (param),
+                              strcmp (argument_member (param), "v_string") == 0 ?
+                                "(gchar *) " : "",
+                              param->name);
+    }
+
+  if (method->params->len > 0)
+    g_string_append (source, "\n");
+
+  g_string_append (source,
+                   "  if (!peas_extension_call_methodv (exten, (PeasMethod *) method,\n"
+                   "                                    args, &return_value))\n"
+                   "    data->ret = FALSE;\n"
+                   "}\n\n");
+
+  /* The wrapper itself */
+  g_string_append_printf (source, "gboolean\n%s ", function_name);
+  append_parameters (source, method, strlen (function_name) + 1);
+  g_string_append_printf (source,
+                          "\n{\n"
+                          "  struct %s_data data;\n\n"
+                          "  g_return_val_if_fail (PEAS_IS_EXTENSION_SET (set), FALSE);\n\n"
+                          "  data.ret = TRUE;\n",
+                          function_name);
+
+  for (i = 0; i < method->params->len; i++)
+    {
+      const Param *param = g_ptr_array_index (method->params, i);
+
+      g_string_append_printf (source, "  data.%s = %s;\n",
+                              param->name, param->name);
+    }
+
+  g_string_append_printf (source,
+                          "\n"
+                          "  peas_extension_set_foreach (set, %s_cb, &data);\n\n"
+                          "  return data.ret;\n"
+                          "}\n\n",
+                          function_name);
+
+  g_free (function_name);
+}
+
+static gchar *
+header_guard (const gchar *basename)
+{
+  gchar *guard, *p;
+
+  guard = g_strdup_printf ("__%s_H__", basename);
+
+  for (p = guard; *p != '\0'; p++)
+    *p = g_ascii_isalnum (*p) ? g_ascii_toupper (*p) : '_';
+
+  return guard;
+}
+
+static gboolean
+generate (const Interface  *iface,
+          const gchar      *gir_file,
+          GError          **error)
+{
+  GString *header, *source;
+  gchar *basename, *guard, *filename;
+  guint i;
+  gboolean ret;
+
+  basename = g_path_get_basename (output);
+  guard = header_guard (basename);
+
+  header = g_string_new (NULL);
+  source = g_string_new (NULL);
+
+  g_string_append_printf (header,
+                          "/* Generated by peas-codegen from %s, do not edit. */\n\n"
+                          "#ifndef %s\n"
+                          "#define %s\n\n"
+                          "#include <libpeas/peas.h>\n",
+                          gir_file, guard, guard);
+
+  /* The headers declare the types of the parameters */
+  for (i = 0; includes != NULL && includes[i] != NULL; i++)
+    g_string_append_printf (header, "#include \"%s\"\n", includes[i]);
+
+  g_string_append (header, "\nG_BEGIN_DECLS\n\n");
+
+  g_string_append_printf (source,
+                          "/* Generated by peas-codegen from %s, do not edit. */\n\n"
+                          "#include \"%s.h\"\n\n",
+                          gir_file, basename);
+
+  for (i = 0; i < iface->methods->len; i++)
+    {
+      const Method *method = g_ptr_array_index (iface->methods, i);
+      const gchar *vfunc_name;
+
+      vfunc_name = g_hash_table_lookup (iface->invokers, method->name);
+      if (vfunc_name == NULL)
+        continue;
+
+      if (method->unsupported)
+        {
+          g_printerr ("Skipping method '%s.%s'\n",
+                      iface->interface_name, method->name);
+          continue;
+        }
+
+      generate_wrapper (iface, method, vfunc_name, header, source);
+    }
+
+  g_string_append_printf (header, "\nG_END_DECLS\n\n#endif /* %s */\n", guard);
+
+  filename = g_strdup_printf ("%s.h", output);
+  ret = g_file_set_contents (filename, header->str, header->len, error);
+  g_free (filename);
+
+  if (ret)
+    {
+      filename = g_strdup_printf ("%s.c", output);
+      ret = g_file_set_contents (filename, source->str, source->len, error);
+      g_free (filename);
+    }
+
+  g_string_free (header, TRUE);
+  g_string_free (source, TRUE);
+  g_free (guard);
+  g_free (basename);
+
+  return ret;
+}
+
+/* my_iface_get_type -> my_iface */
+static gchar *
+default_prefix (const gchar *get_type)
+{
+  if (!g_str_has_suffix (get_type, "_get_type"))
+    return g_ascii_strdown (get_type, -1);
+
+  return g_strndup (get_type, strlen (get_type) - strlen ("_get_type"));
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  GOptionContext *context;
+  Interface iface = { 0 };
+  GError *error = NULL;
+
+  context = g_option_context_new ("- generate typed PeasExtensionSet wrappers");
+  g_option_context_add_main_entries (context, options, NULL);
+
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      return EXIT_FAILURE;
+    }
+
+  g_option_context_free (context);
+
+  if (interface_name == NULL || output == NULL ||
+      gir_files == NULL || gir_files[0] == NULL || gir_files[1] != NULL)
+    {
+      g_printerr ("Usage: %s --interface=NAME --output=BASENAME GIR-FILE\n",
+                  g_get_prgname ());
+      return EXIT_FAILURE;
+    }
+
+  iface.interface_name = interface_name;
+  iface.methods = g_ptr_array_new_with_free_func ((GDestroyNotify) method_free);
+  iface.invokers = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                          g_free, g_free);
+
+  if (!parse_gir (gir_files[0], &iface, &error))
+    {
+      g_printerr ("Could not parse '%s': %s\n", gir_files[0], error->message);
+      return EXIT_FAILURE;
+    }
+
+  if (!iface.found || iface.get_type == NULL || iface.c_type == NULL ||
+      iface.struct_c_type == NULL)
+    {
+      g_printerr ("Interface '%s' not found in '%s'\n",
+                  interface_name, gir_files[0]);
+      return EXIT_FAILURE;
+    }
+
+  if (prefix == NULL)
+    prefix = default_prefix (iface.get_type);
+
+  if (!generate (&iface, gir_files[0], &error))
+    {
+      g_printerr ("%s\n", error->message);
+      return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}